@@ -0,0 +1,849 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Regex.h"
+#include "Lexer.h"
+#include "NPIConvertor.h"
+#include "NFABuilder.h"
+#include "Optimizer.h"
+
+// Every result is printed as one JSON object per line, so that runs of
+// different releases can be diffed or loaded by a script.
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedNs(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// corpora
+
+static std::string const LOWER = "abcdefghijklmnopqrstuvwxyz";
+static std::string const DIGITS = "0123456789";
+
+static std::vector<std::string> logLines(size_t count)
+{
+  static char const* levels[] = { "INFO", "WARN", "ERROR", "DEBUG" };
+  static char const* words[] = {
+    "request", "served", "user", "timeout", "cache", "miss", "disk", "full"
+  };
+  std::mt19937 rng(1);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < count; i++)
+  {
+    std::ostringstream line;
+    line << "2014" << rng() % 10 << rng() % 10 << " " << levels[rng() % 4];
+    for (size_t w = 0, n = 4 + rng() % 8; w < n; w++)
+    {
+      line << " " << words[rng() % 8];
+    }
+    line << " id" << rng() % 100000;
+    lines.push_back(line.str());
+  }
+  return lines;
+}
+
+static std::vector<std::string> randomText(size_t count, size_t length,
+  std::string const& alphabet, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < count; i++)
+  {
+    std::string line;
+    for (size_t j = 0; j < length; j++)
+    {
+      line += alphabet[rng() % alphabet.size()];
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+// UTF-8 words: Cyrillic, accented Latin and ASCII
+static std::vector<std::string> utf8Lines(size_t count, unsigned seed)
+{
+  static char const* words[] = {
+    "\xD0\xB7\xD0\xB0\xD0\xBF\xD1\x80\xD0\xBE\xD1\x81",
+    "\xD0\xBA\xD1\x8D\xD1\x88", "caf\xC3\xA9", "user", "disk",
+    "\xD0\xBE\xD1\x88\xD0\xB8\xD0\xB1\xD0\xBA\xD0\xB0", "\xE2\x82\xAC"
+  };
+  std::mt19937 rng(seed);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < count; i++)
+  {
+    std::string line = words[rng() % 7];
+    for (size_t w = 0, n = 8 + rng() % 8; w < n; w++)
+    {
+      line += std::string(" ") + words[rng() % 7];
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+// patterns, written with the operators the Lexer knows
+
+static std::string anyOf(std::string const& symbols)
+{
+  std::string result = "(";
+  for (size_t i = 0; i < symbols.size(); i++)
+  {
+    result += (i == 0 ? "" : "|") + std::string(1, symbols[i]);
+  }
+  return result + ")";
+}
+
+static std::string repeat(std::string const& str, size_t count)
+{
+  std::string result;
+  for (size_t i = 0; i < count; i++)
+  {
+    result += str;
+  }
+  return result;
+}
+
+// measures
+
+struct CompileTimes
+{
+  double lexerNs = 0;
+  double npiNs = 0;
+  double optimizerNs = 0;
+  double nfaNs = 0;
+  double regexNs = 0;
+  double allocations = 0;
+};
+
+static CompileTimes measureCompile(std::string const& pattern,
+  CompileOptions const& options, size_t rounds)
+{
+  CompileTimes times;
+  for (size_t i = 0; i < rounds; i++)
+  {
+    std::vector<Token<char>> tokens;
+    std::vector<Token<char>> npi;
+    std::vector<Token<char>> optimized;
+    NFA<char> nfa;
+
+    auto start = Clock::now();
+    Lexer<char> lexer(pattern.c_str(), tokens);
+    times.lexerNs += elapsedNs(start);
+
+    start = Clock::now();
+    NPIConvertor<char> convertor(tokens, npi);
+    times.npiNs += elapsedNs(start);
+
+    start = Clock::now();
+    Optimizer<char> optimizer(npi, optimized);
+    times.optimizerNs += elapsedNs(start);
+
+    start = Clock::now();
+    NFABuilder<char> builder(optimized, nfa);
+    times.nfaNs += elapsedNs(start);
+
+    size_t before = allocations;
+    start = Clock::now();
+    Regex re(pattern, options);
+    times.regexNs += elapsedNs(start);
+    times.allocations += allocations - before;
+  }
+  times.lexerNs /= rounds;
+  times.npiNs /= rounds;
+  times.optimizerNs /= rounds;
+  times.nfaNs /= rounds;
+  times.regexNs /= rounds;
+  times.allocations /= rounds;
+  return times;
+}
+
+static double percentile(std::vector<double>& sorted, double p)
+{
+  size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+  return sorted[index];
+}
+
+static std::string escape(std::string const& str)
+{
+  std::string result;
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+    {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+static void bench(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus, CompileOptions const& options=CompileOptions())
+{
+  CompileTimes compile = measureCompile(pattern, options, 5);
+  Regex re(pattern, options);
+
+  size_t bytes = 0;
+  size_t matches = 0;
+  std::vector<double> latencies;
+  latencies.reserve(corpus.size());
+
+  size_t before = allocations;
+  auto total = Clock::now();
+  for (auto const& line : corpus)
+  {
+    auto start = Clock::now();
+    matches += re.match(line.c_str()) ? 1 : 0;
+    latencies.push_back(elapsedNs(start));
+    bytes += line.size();
+  }
+  double totalNs = elapsedNs(total);
+  double allocs = static_cast<double>(allocations - before) / corpus.size();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern.size() > 60
+        ? pattern.substr(0, 57) + "..." : pattern) << "\""
+    << ", \"engine\": \"" << CompileOptions::toString(re.getEngine()) << "\""
+    << ", \"lexer_ns\": " << compile.lexerNs
+    << ", \"npi_ns\": " << compile.npiNs
+    << ", \"optimizer_ns\": " << compile.optimizerNs
+    << ", \"nfa_builder_ns\": " << compile.nfaNs
+    << ", \"compile_ns\": " << compile.regexNs
+    << ", \"compile_allocs\": " << compile.allocations
+    << ", \"inputs\": " << corpus.size()
+    << ", \"matches\": " << matches
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (totalNs / 1e9)
+    << ", \"p50_ns\": " << percentile(latencies, 0.50)
+    << ", \"p90_ns\": " << percentile(latencies, 0.90)
+    << ", \"p99_ns\": " << percentile(latencies, 0.99)
+    << ", \"max_ns\": " << latencies.back()
+    << ", \"allocs_per_match\": " << allocs
+    << "}" << std::endl;
+}
+
+// a DFA larger than the caches, as built and once trained on the corpus
+static void benchDFALayout(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus, CompileOptions const& options)
+{
+  Regex re(pattern, options);
+  double mbPerS[2];
+  size_t matches = 0;
+  for (int trained = 0; trained < 2; trained++)
+  {
+    if (trained)
+    {
+      re.train(std::vector<std::string>(corpus.begin(), corpus.begin() + corpus.size() / 10));
+    }
+    size_t bytes = 0;
+    matches = 0;
+    auto start = Clock::now();
+    for (auto const& line : corpus)
+    {
+      matches += re.match(line) ? 1 : 0;
+      bytes += line.size();
+    }
+    mbPerS[trained] = (bytes / 1e6) / (elapsedNs(start) / 1e9);
+  }
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"engine\": \"" << CompileOptions::toString(re.getEngine()) << "\""
+    << ", \"inputs\": " << corpus.size()
+    << ", \"matches\": " << matches
+    << ", \"mb_per_s\": " << mbPerS[0]
+    << ", \"trained_mb_per_s\": " << mbPerS[1]
+    << "}" << std::endl;
+}
+
+// every core matches the corpus with the same regex
+static void benchThreads(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus, CompileOptions const& options)
+{
+  Regex re(pattern, options);
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::atomic<size_t> matches(0);
+  std::vector<std::thread> workers;
+  auto start = Clock::now();
+  for (unsigned t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&re, &corpus, &matches] () {
+      size_t local = 0;
+      for (auto const& line : corpus)
+      {
+        local += re.match(line) ? 1 : 0;
+      }
+      matches += local;
+    });
+  }
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  double totalNs = elapsedNs(start);
+
+  size_t bytes = 0;
+  for (auto const& line : corpus)
+  {
+    bytes += line.size();
+  }
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"engine\": \"" << CompileOptions::toString(re.getEngine()) << "\""
+    << ", \"threads\": " << threads
+    << ", \"matches\": " << matches
+    << ", \"mb_per_s\": " << (threads * bytes / 1e6) / (totalNs / 1e9)
+    << "}" << std::endl;
+}
+
+// iterates over every match of each input
+static void benchFindAll(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus)
+{
+  Regex re(pattern);
+
+  size_t bytes = 0;
+  size_t matches = 0;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    for (Span const& span : re.findAll(line))
+    {
+      matches += span.length() != 0 ? 1 : 0;
+    }
+    bytes += line.size();
+  }
+  double totalNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"inputs\": " << corpus.size()
+    << ", \"matches\": " << matches
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (totalNs / 1e9)
+    << "}" << std::endl;
+}
+
+// rewrites each input, reusing one output buffer
+static void benchReplace(std::string const& name, std::string const& pattern,
+  std::string const& replacement, std::vector<std::string> const& corpus)
+{
+  Regex re(pattern);
+
+  size_t bytes = 0;
+  size_t written = 0;
+  std::string output;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    output.clear();
+    re.replace(line, replacement, std::back_inserter(output));
+    written += output.size();
+    bytes += line.size();
+  }
+  double totalNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"inputs\": " << corpus.size()
+    << ", \"bytes_written\": " << written
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (totalNs / 1e9)
+    << "}" << std::endl;
+}
+
+// extracts the capture groups of the match of each input
+static void benchCapture(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus, CompileOptions const& options=CompileOptions())
+{
+  Regex re(pattern, options);
+
+  size_t bytes = 0;
+  size_t matches = 0;
+  std::vector<Span> groups;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    matches += re.capture(line, groups) ? 1 : 0;
+    bytes += line.size();
+  }
+  double totalNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"groups\": " << re.groupCount()
+    << ", \"engine\": \"" << escape(re.explain()) << "\""
+    << ", \"inputs\": " << corpus.size()
+    << ", \"matches\": " << matches
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (totalNs / 1e9)
+    << "}" << std::endl;
+}
+
+// matches each input on its own, then the whole corpus as one batch
+static void benchBatch(std::string const& name, std::string const& pattern,
+  std::vector<std::string> const& corpus, CompileOptions const& options=CompileOptions())
+{
+  Regex re(pattern, options);
+
+  size_t bytes = 0;
+  size_t matches = 0;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    matches += re.match(line) ? 1 : 0;
+    bytes += line.size();
+  }
+  double singleNs = elapsedNs(start);
+
+  std::vector<bool> results;
+  re.matchBatch(corpus, results);
+  start = Clock::now();
+  re.matchBatch(corpus, results);
+  double batchNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"engine\": \"" << CompileOptions::toString(re.getEngine()) << "\""
+    << ", \"inputs\": " << corpus.size()
+    << ", \"matches\": " << matches
+    << ", \"single_mb_per_s\": " << (bytes / 1e6) / (singleNs / 1e9)
+    << ", \"batch_mb_per_s\": " << (bytes / 1e6) / (batchNs / 1e9)
+    << "}" << std::endl;
+}
+
+// compiles a whole rule set at once
+static void benchCompileAll(std::string const& name,
+  std::vector<std::string> const& patterns, unsigned threads)
+{
+  auto start = Clock::now();
+  auto compiled = compileAll<Regex>(patterns, CompileOptions(), threads);
+  double totalNs = elapsedNs(start);
+
+  size_t failures = 0;
+  for (auto const& result : compiled)
+  {
+    failures += result.regex ? 0 : 1;
+  }
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"patterns\": " << patterns.size()
+    << ", \"threads\": " << threads
+    << ", \"failures\": " << failures
+    << ", \"patterns_per_s\": " << patterns.size() / (totalNs / 1e9)
+    << "}" << std::endl;
+}
+
+// copies a whole rule set, as a configuration snapshot does
+static void benchSnapshot(std::string const& name,
+  std::vector<std::string> const& patterns)
+{
+  std::vector<Regex> rules;
+  for (auto const& pattern : patterns)
+  {
+    rules.emplace_back(pattern);
+  }
+
+  size_t before = allocations;
+  auto start = Clock::now();
+  std::vector<Regex> snapshot(rules);
+  double totalNs = elapsedNs(start);
+  double allocs = static_cast<double>(allocations - before) / rules.size();
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"patterns\": " << snapshot.size()
+    << ", \"copy_ns\": " << totalNs / rules.size()
+    << ", \"allocs_per_copy\": " << allocs
+    << "}" << std::endl;
+}
+
+// matches through a HotSwap, alone and while another thread keeps
+// publishing new versions of the rule, against the regex matched directly
+static void benchHotSwap(std::string const& name, std::string const& pattern,
+  std::string const& other, std::vector<std::string> const& corpus)
+{
+  static const int PASSES = 10;
+
+  Regex re(pattern);
+  HotSwap<Regex> rules(re);
+  size_t bytes = 0;
+  for (auto const& line : corpus)
+  {
+    bytes += line.size();
+  }
+
+  size_t matches = 0;
+  auto start = Clock::now();
+  for (int pass = 0; pass < PASSES; pass++)
+  {
+    for (auto const& line : corpus)
+    {
+      matches += re.match(line) ? 1 : 0;
+    }
+  }
+  double directNs = elapsedNs(start);
+
+  start = Clock::now();
+  for (int pass = 0; pass < PASSES; pass++)
+  {
+    for (auto const& line : corpus)
+    {
+      matches += rules.read()->match(line) ? 1 : 0;
+    }
+  }
+  double readNs = elapsedNs(start);
+
+  std::atomic<bool> done(false);
+  size_t swaps = 0;
+  std::thread reloader([&] () {
+    while (!done)
+    {
+      rules.reload(swaps % 2 == 0 ? other : pattern).get();
+      swaps++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  start = Clock::now();
+  for (int pass = 0; pass < PASSES; pass++)
+  {
+    for (auto const& line : corpus)
+    {
+      matches += rules.read()->match(line) ? 1 : 0;
+    }
+  }
+  double reloadingNs = elapsedNs(start);
+  done = true;
+  reloader.join();
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(pattern) << "\""
+    << ", \"engine\": \"" << CompileOptions::toString(re.getEngine()) << "\""
+    << ", \"swaps\": " << swaps
+    << ", \"direct_mb_per_s\": " << (PASSES * bytes / 1e6) / (directNs / 1e9)
+    << ", \"read_mb_per_s\": " << (PASSES * bytes / 1e6) / (readNs / 1e9)
+    << ", \"reloading_mb_per_s\": " << (PASSES * bytes / 1e6) / (reloadingNs / 1e9)
+    << "}" << std::endl;
+}
+
+// splits source lines into tokens with one Tokenizer, and with a loop over
+// one regex per pattern, which searches each of them at every token
+static void benchTokenizer(std::string const& name,
+  std::vector<std::string> const& patterns, std::vector<std::string> const& corpus)
+{
+  Tokenizer tokenizer(patterns);
+  std::vector<Regex> regexes(patterns.begin(), patterns.end());
+
+  size_t bytes = 0;
+  size_t tokens = 0;
+  std::vector<TokenMatch> output;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    output.clear();
+    tokenizer.tokenize(line.c_str(), std::back_inserter(output));
+    tokens += output.size();
+    bytes += line.size();
+  }
+  double tokenizerNs = elapsedNs(start);
+
+  size_t loopTokens = 0;
+  start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    for (size_t position = 0; position < line.size(); loopTokens++)
+    {
+      size_t longest = 0;
+      for (auto const& re : regexes)
+      {
+        Span span;
+        if (re.search(line.c_str() + position, span) && span.begin == 0)
+        {
+          longest = std::max(longest, span.end);
+        }
+      }
+      if (longest == 0)
+      {
+        break;
+      }
+      position += longest;
+    }
+  }
+  double loopNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"patterns\": " << patterns.size()
+    << ", \"dfa_states\": " << tokenizer.stateCount()
+    << ", \"tokens\": " << tokens
+    << ", \"loop_tokens\": " << loopTokens
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (tokenizerNs / 1e9)
+    << ", \"loop_mb_per_s\": " << (bytes / 1e6) / (loopNs / 1e9)
+    << "}" << std::endl;
+}
+
+// statements of a C-like language
+static std::vector<std::string> sourceLines(size_t count)
+{
+  static char const* const WORDS[] = { "if", "else", "while", "return", "int",
+    "count", "index", "x1", "value_2", "42", "7", "==", "=", "+", "<=", "(",
+    ")", ";", "{", "}", "ifdef", "returned" };
+  std::mt19937 random(9);
+  std::vector<std::string> lines;
+  for (size_t i = 0; i < count; i++)
+  {
+    std::string line;
+    for (size_t words = 8 + random() % 8; words > 0; words--)
+    {
+      line += WORDS[random() % (sizeof(WORDS) / sizeof(*WORDS))];
+      line += random() % 3 == 0 ? "" : " ";
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+static unsigned editDistance(std::string const& a, std::string const& b)
+{
+  std::vector<unsigned> row(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); j++)
+  {
+    row[j] = static_cast<unsigned>(j);
+  }
+  for (size_t i = 1; i <= a.size(); i++)
+  {
+    unsigned diagonal = row[0];
+    row[0] = static_cast<unsigned>(i);
+    for (size_t j = 1; j <= b.size(); j++)
+    {
+      unsigned above = row[j];
+      row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1),
+        diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+      diagonal = above;
+    }
+  }
+  return row[b.size()];
+}
+
+// finds a word within some edits in each line, with searchApprox() and with
+// the edit distance of every window of the line around the word's length
+static void benchApprox(std::string const& name, std::string const& word,
+  std::vector<std::string> const& corpus, unsigned maxErrors)
+{
+  Regex re(word);
+
+  size_t bytes = 0;
+  size_t matches = 0;
+  auto start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    Span span;
+    matches += re.searchApprox(line, maxErrors, span) ? 1 : 0;
+    bytes += line.size();
+  }
+  double approxNs = elapsedNs(start);
+
+  size_t loopMatches = 0;
+  start = Clock::now();
+  for (auto const& line : corpus)
+  {
+    bool found = false;
+    for (size_t begin = 0; begin < line.size() && !found; begin++)
+    {
+      size_t shortest = word.size() > maxErrors ? word.size() - maxErrors : 0;
+      for (size_t length = shortest; length <= word.size() + maxErrors
+        && begin + length <= line.size() && !found; length++)
+      {
+        found = editDistance(line.substr(begin, length), word) <= maxErrors;
+      }
+    }
+    loopMatches += found ? 1 : 0;
+  }
+  double loopNs = elapsedNs(start);
+
+  std::cout << "{\"bench\": \"" << name << "\""
+    << ", \"pattern\": \"" << escape(word) << "\""
+    << ", \"max_errors\": " << maxErrors
+    << ", \"matches\": " << matches
+    << ", \"loop_matches\": " << loopMatches
+    << ", \"mb_per_s\": " << (bytes / 1e6) / (approxNs / 1e9)
+    << ", \"loop_mb_per_s\": " << (bytes / 1e6) / (loopNs / 1e9)
+    << "}" << std::endl;
+}
+
+int main()
+{
+  std::string any = anyOf(LOWER + DIGITS + " ");
+
+  // log lines
+  auto logs = logLines(20000);
+  bench("log_error", any + "*ERROR" + any + "*", logs);
+  bench("log_level", "2014" + anyOf(DIGITS) + anyOf(DIGITS) + " "
+    + "((INFO)|(WARN)|(ERROR)|(DEBUG))" + any + "*", logs);
+
+  // random text
+  auto text = randomText(2000, 256, LOWER + " ", 2);
+  bench("text_word", anyOf(LOWER + " ") + "*regex" + anyOf(LOWER + " ") + "*", text);
+  bench("text_literal", text[0], text);
+
+  // DNA
+  auto dna = randomText(2000, 1024, "acgt", 3);
+  bench("dna_motif", "(a|c|g|t)*gattaca(a|c|g|t)*", dna);
+  bench("dna_alternation", "(acgt)|(tgca)|(gattaca)|(cattag)", dna);
+
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  bench("dna_motif_lazy", "(a|c|g|t)*gattaca(a|c|g|t)*", dna, lazy);
+  benchThreads("dna_motif_lazy_threads", "(a|c|g|t)*gattaca(a|c|g|t)*", dna, lazy);
+  benchThreads("exponential_lazy_threads", "(a|b)*a" + repeat("(a|b)", 10),
+    randomText(200, 1024, "ab", 4), lazy);
+
+  // UTF-8, matched on the bytes
+  CompileOptions utf8;
+  utf8.utf8 = true;
+  auto utf8Text = utf8Lines(5000, 5);
+  bench("utf8_any", ".*\xD0\xBE\xD1\x88\xD0\xB8\xD0\xB1\xD0\xBA\xD0\xB0.*", utf8Text, utf8);
+  bench("utf8_class", "[\xD0\x80-\xD3\xBF ]+", utf8Text, utf8);
+
+  // long records decided by their first bytes
+  auto records = randomText(2000, 4096, LOWER, 6);
+  bench("long_reject", "id=[0-9]+ .*", records);
+  bench("long_reject_lazy", "id=[0-9]+ .*", records, lazy);
+  bench("long_accept_forever", "[a-z].*", records);
+  bench("long_accept_forever_lazy", "[a-z].*", records, lazy);
+
+  // pathological patterns
+  for (size_t n : { 8, 16, 32 })
+  {
+    std::vector<std::string> input { std::string(n, 'a') };
+    std::string pattern = repeat("a?", n) + std::string(n, 'a');
+    std::vector<std::string> inputs(200, input[0]);
+    bench("optional_" + std::to_string(n), pattern, inputs);
+    bench("optional_lazy_" + std::to_string(n), pattern, inputs, lazy);
+  }
+
+  std::vector<std::string> aaa(200, std::string(64, 'a'));
+  bench("a_or_aa_star_b", "(a|aa)*b", aaa);
+
+  // 2^n DFA states, which thrash the lazy DFA cache
+  auto ab = randomText(200, 1024, "ab", 4);
+  CompileOptions small = lazy;
+  small.cacheBudget = 1 << 14;
+  bench("exponential_dfa", "(a|b)*a" + repeat("(a|b)", 12), ab, small);
+  CompileOptions large;
+  large.engine = CompileOptions::EAGER_DFA;
+  large.maxDFAStates = 1 << 17;
+  // a skewed text visits a small part of the 2^16 states
+  auto mostlyB = randomText(400, 4096, "abbbbbbbbbbbbbbb", 5);
+  benchDFALayout("large_dfa", "(a|b)*a" + repeat("(a|b)", 15), mostlyB, large);
+
+  // tokenizing
+  benchFindAll("find_all_words", "[a-z]+", text);
+  benchFindAll("find_all_numbers", "[0-9]+", logs);
+
+  // field extraction
+  benchCapture("capture_fields", "([A-Z]+) ([a-z ]+) id([0-9]+)", logs);
+  benchCapture("capture_one_pass", "([A-Z]+) ([a-z]+)", logs);
+
+  // short keys; without DFAs, the backtracker avoids the PikeVM setup
+  std::vector<std::string> keys;
+  for (auto const& word : randomText(50000, 12, LOWER + "_", 8))
+  {
+    keys.push_back(word + "_" + std::to_string(word.size() * 7919 % 1000));
+  }
+  benchCapture("capture_short_keys", "([a-z_]+)_([0-9]+)", keys);
+  CompileOptions noDFA;
+  noDFA.maxDFAStates = 0;
+  benchCapture("capture_short_keys_nfa", "([a-z_]+)_([0-9]+)", keys, noDFA);
+
+  // validating many short keys
+  benchBatch("batch_short_keys", "[a-z]+(_[a-z]+)*_[0-9]+", keys);
+  benchBatch("batch_short_keys_lazy", "[a-z]+(_[a-z]+)*_[0-9]+", keys, lazy);
+  std::vector<std::string> mixedKeys;
+  std::mt19937 lengths(10);
+  for (auto const& word : randomText(50000, 40, LOWER + "_", 11))
+  {
+    mixedKeys.push_back(word.substr(0, 6 + lengths() % 31) + "_"
+      + std::to_string(lengths() % 1000));
+  }
+  benchBatch("batch_mixed_keys", "[a-z]+(_[a-z]+)*_[0-9]+", mixedKeys);
+
+  // redaction
+  benchReplace("replace_numbers", "[0-9]+", "#", logs);
+
+  // a rule set: many small patterns compiled together
+  std::vector<std::string> rules;
+  for (auto const& word : randomText(20000, 8, LOWER, 7))
+  {
+    rules.push_back(any + "*" + word.substr(0, 4) + "(" + word.substr(4) + ")?"
+      + anyOf(DIGITS) + "+");
+  }
+  benchCompileAll("compile_all_1", rules, 1);
+  benchCompileAll("compile_all", rules, 0);
+  benchSnapshot("snapshot", std::vector<std::string>(rules.begin(), rules.begin() + 2000));
+
+  // misspelt words
+  benchApprox("approx_0", "timeuot", logs, 0);
+  benchApprox("approx_1", "timeuot", logs, 1);
+  benchApprox("approx_2", "timeuot", logs, 2);
+
+  // a lexer for a C-like language
+  std::vector<std::string> grammar { "if", "else", "while", "for", "return",
+    "int", "char", "void", "struct", "break", "continue", "[a-z_][a-z0-9_]*",
+    "[0-9]+", " +", "==", "!=", "<=", ">=", "=", "<", ">", "\\+", "-", "\\*",
+    "/", ";", ",", "\\(", "\\)", "{", "}" };
+  benchTokenizer("tokenizer", grammar, sourceLines(20000));
+
+  // rules reloaded while the traffic keeps flowing
+  benchHotSwap("hot_swap", any + "*ERROR" + any + "*", any + "*WARN" + any + "*", logs);
+
+  return 0;
+}
@@ -20,37 +20,74 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <iostream>
+#include <cstring>
+#include <string>
 
 #include "Regex.h"
 
+static int usage(char const* program)
+{
+  std::cerr << "usage: " << program << " [--stats=json|prometheus] regexp string"
+    << std::endl;
+  return 1;
+}
+
+// RegexT counts what the match costs only if the stats are asked for
+template <typename RegexT>
+static int run(char const* pattern, char const* input, std::string const& stats)
+{
+  RegexT re(pattern);
+  bool matched = re.match(input);
+  std::cout << (matched ? "matched" : "mismatched") << std::endl;
+  if (stats == "json")
+  {
+    std::cout << re.getStats().toJSON() << std::endl;
+  }
+  else if (stats == "prometheus")
+  {
+    std::cout << re.getStats().toPrometheus(pattern);
+  }
+  return matched ? 0 : 1;
+}
+
 int main(int argc, char const *argv[])
 {
-  if (argc < 3)
+  std::string stats;
+  int first = 1;
+  if (argc > 1 && std::strncmp(argv[1], "--stats=", 8) == 0)
+  {
+    stats = argv[1] + 8;
+    first = 2;
+    if (stats != "json" && stats != "prometheus")
+    {
+      return usage(argv[0]);
+    }
+  }
+
+  if (argc - first < 2)
   {
-    std::cerr << "usage: " << argv[0] << "regexp string" << std::endl;
-    return 1;
+    return usage(argv[0]);
   }
   else
   {
     try
     {
-      Regex re(argv[1]);
-      if (re.match(argv[2]))
+      if (stats.empty())
       {
-        std::cout << "matched" << std::endl;
-        return 0;
-      }
-      else
-      {
-        std::cout << "mismatched" << std::endl;
-        return 1;
+        return run<Regex>(argv[first], argv[first + 1], stats);
       }
+      return run<InstrumentedRegex>(argv[first], argv[first + 1], stats);
     }
-    catch (std::invalid_argument e)
+    catch (std::invalid_argument const& e)
     {
       std::cerr << "syntax error" << std::endl;;
       return 1;
     }
+    catch (ComplexityError const& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
   }
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,246 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <limits>
+#include <queue>
+#include <string>
+#include <set>
+#include <vector>
+
+#include "Lexemes.h"
+#include "Span.h"
+#include "SymbolClasses.h"
+
+// Engine for the patterns that are an alternation of plain strings: a trie
+// of the strings, completed with the failure links of Aho and Corasick
+// (1975) so that find() scans its input once. The edges of the trie are a
+// row per node, with a column per symbol of the strings and one for each
+// range of the other symbols (see SymbolClasses).
+template <typename SymbolT>
+class AhoCorasick
+{
+private:
+  typedef unsigned int _NodeId;
+
+  static const _NodeId _NONE = std::numeric_limits<_NodeId>::max();
+  static const size_t _NO_OUTPUT = std::numeric_limits<size_t>::max();
+
+  struct _Node
+  {
+    _NodeId fail = 0;
+    size_t depth = 0;
+    // length of the longest string ending here, following the failure links,
+    // or _NO_OUTPUT
+    size_t output = _NO_OUTPUT;
+    bool terminal = false;
+  };
+
+  SymbolClasses<SymbolT> _classes;
+  size_t _columns;
+  std::vector<_Node> _nodes;
+  std::vector<_NodeId> _next; // _NONE if no edge
+  size_t _count = 0;
+
+public:
+  AhoCorasick() :
+    _columns(_classes.size()), _nodes(1), _next(_columns, _NONE)
+  {}
+
+  template <typename Container>
+  explicit AhoCorasick(Container const& strings) :
+    _classes(_classesOf(strings)), _columns(_classes.size()), _nodes(1),
+    _next(_columns, _NONE)
+  {
+    for (auto const& str : strings)
+    {
+      _insert(str);
+    }
+    _link();
+  }
+
+  size_t size() const
+  {
+    return _count;
+  }
+
+  // true if the whole input is one of the strings
+  bool match(SymbolT const* input) const
+  {
+    _NodeId node = 0;
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END; i++)
+    {
+      node = _goto(node, input[i]);
+      if (node == _NONE)
+      {
+        return false;
+      }
+    }
+    return _nodes[node].terminal;
+  }
+
+  // Finds the leftmost occurrence in [begin, end), the longest one if
+  // several start there. Returns false if there is none. The first
+  // occurrence to end is a candidate; the scan goes on while the trie path
+  // may still hold an occurrence starting at or before the candidate.
+  bool find(SymbolT const* begin, SymbolT const* end,
+    SymbolT const*& matchBegin, SymbolT const*& matchEnd) const
+  {
+    _NodeId node = 0;
+    bool found = false;
+    for (SymbolT const* it = begin; ; it++)
+    {
+      _Node const& current = _nodes[node];
+      if (found && current.depth < static_cast<size_t>(it - matchBegin))
+      {
+        return true;
+      }
+      // the longest string ending here starts the leftmost
+      if (current.output != _NO_OUTPUT
+        && (!found || it - current.output <= matchBegin))
+      {
+        matchBegin = it - current.output;
+        matchEnd = it;
+        found = true;
+      }
+      if (it == end)
+      {
+        return found;
+      }
+      node = _step(node, *it);
+    }
+  }
+
+  // the leftmost-longest occurrence in [begin, end), as a Span from 'begin'
+  bool search(SymbolT const* begin, SymbolT const* end, Span& span) const
+  {
+    SymbolT const* matchBegin;
+    SymbolT const* matchEnd;
+    if (!find(begin, end, matchBegin, matchEnd))
+    {
+      return false;
+    }
+    span.begin = matchBegin - begin;
+    span.end = matchEnd - begin;
+    return true;
+  }
+
+private:
+  template <typename Container>
+  static SymbolClasses<SymbolT> _classesOf(Container const& strings)
+  {
+    std::set<SymbolT> starts;
+    for (auto const& str : strings)
+    {
+      for (auto symbol : str)
+      {
+        SymbolClasses<SymbolT>::split(starts, symbol, symbol);
+      }
+    }
+    return SymbolClasses<SymbolT>(starts);
+  }
+
+  _NodeId _goto(_NodeId node, SymbolT symbol) const
+  {
+    return _next[node * _columns + _classes.classOf(symbol)];
+  }
+
+  _NodeId _step(_NodeId node, SymbolT symbol) const
+  {
+    for (;;)
+    {
+      _NodeId next = _goto(node, symbol);
+      if (next != _NONE)
+      {
+        return next;
+      }
+      if (node == 0)
+      {
+        return 0;
+      }
+      node = _nodes[node].fail;
+    }
+  }
+
+  void _insert(std::basic_string<SymbolT> const& str)
+  {
+    _NodeId node = 0;
+    for (auto symbol : str)
+    {
+      _NodeId next = _goto(node, symbol);
+      if (next == _NONE)
+      {
+        next = static_cast<_NodeId>(_nodes.size());
+        _nodes.emplace_back();
+        _nodes.back().depth = _nodes[node].depth + 1;
+        _next.insert(_next.end(), _columns, _NONE);
+        _next[node * _columns + _classes.classOf(symbol)] = next;
+      }
+      node = next;
+    }
+    if (!_nodes[node].terminal)
+    {
+      _nodes[node].terminal = true;
+      _count++;
+    }
+  }
+
+  // breadth-first, so that the failure target of a node is always done
+  // before the node itself.
+  void _link()
+  {
+    std::queue<_NodeId> queue;
+    queue.push(0);
+    while (!queue.empty())
+    {
+      _NodeId node = queue.front();
+      queue.pop();
+
+      _Node& current = _nodes[node];
+      if (current.terminal)
+      {
+        current.output = current.depth;
+      }
+      else if (node != 0)
+      {
+        current.output = _nodes[current.fail].output;
+      }
+
+      for (size_t column = 0; column < _columns; column++)
+      {
+        _NodeId child = _next[node * _columns + column];
+        if (child != _NONE)
+        {
+          _nodes[child].fail = node == 0 ? 0
+            : _step(_nodes[node].fail, _classes.representative(column));
+          queue.push(child);
+        }
+      }
+    }
+  }
+};
+
+template <typename SymbolT>
+const typename AhoCorasick<SymbolT>::_NodeId AhoCorasick<SymbolT>::_NONE;
+
+#endif // AHO_CORASICK_H
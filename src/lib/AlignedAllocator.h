@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__)
+# include <sys/mman.h>
+#endif
+
+// An allocator whose blocks start on an ALIGNMENT boundary (e.g. a cache
+// line). The blocks of at least HUGE_PAGE bytes are aligned on a huge page
+// and, on Linux, advised to be backed by transparent huge pages, so that a
+// large table does not thrash the TLB.
+template <typename T, size_t ALIGNMENT>
+class AlignedAllocator
+{
+public:
+  typedef T value_type;
+
+  static const size_t HUGE_PAGE = 2 << 20;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef AlignedAllocator<U, ALIGNMENT> other;
+  };
+
+  AlignedAllocator() = default;
+
+  template <typename U>
+  AlignedAllocator(AlignedAllocator<U, ALIGNMENT> const&)
+  {}
+
+  T* allocate(size_t count)
+  {
+    size_t bytes = count * sizeof(T);
+    size_t alignment = bytes >= HUGE_PAGE ? HUGE_PAGE : ALIGNMENT;
+    void* block = nullptr;
+    if (posix_memalign(&block, alignment, bytes) != 0)
+    {
+      throw std::bad_alloc();
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (bytes >= HUGE_PAGE)
+    {
+      madvise(block, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return static_cast<T*>(block);
+  }
+
+  void deallocate(T* block, size_t)
+  {
+    free(block);
+  }
+
+  template <typename U>
+  bool operator==(AlignedAllocator<U, ALIGNMENT> const&) const
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(AlignedAllocator<U, ALIGNMENT> const&) const
+  {
+    return false;
+  }
+};
+
+template <typename T, size_t ALIGNMENT>
+const size_t AlignedAllocator<T, ALIGNMENT>::HUGE_PAGE;
+
+#endif // ALIGNED_ALLOCATOR_H
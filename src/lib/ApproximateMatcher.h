@@ -0,0 +1,224 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef APPROXIMATE_MATCHER_H
+#define APPROXIMATE_MATCHER_H
+
+#include <vector>
+
+#include "BitParallel.h"
+#include "Lexemes.h"
+#include "PositionAutomaton.h"
+#include "Span.h"
+
+// Matches within a number of edits (insertions, deletions and substitutions
+// of one symbol) of a pattern whose position automaton fits in a machine
+// word: Wu and Manber's extension of the bit-parallel simulation (see
+// BitParallel), with one set of active positions R[j] per number of errors
+// j <= k. A step on the symbol c is
+//   R'[0] = Follow(R[0]) & B[c]
+//   R'[j] = Follow(R[j]) & B[c]                 c is matched
+//         | R[j-1]                              c is inserted
+//         | Follow(R[j-1])                      c is substituted
+//         | Follow(R'[j-1]) | R'[j-1]           a position is deleted
+// so a scan costs 2k + 1 follow lookups per symbol, whatever the pattern.
+// A search finds where the first occurrence ends, then where it starts by
+// running the mirror automaton backward from there.
+template <typename SymbolT>
+class ApproximateMatcher
+{
+public:
+  typedef typename PositionAutomaton<SymbolT>::Mask Mask;
+
+private:
+  // below, the levels of a scan are on the stack
+  static const unsigned _LOCAL_LEVELS = 16;
+
+  struct _Levels
+  {
+    Mask local[_LOCAL_LEVELS];
+    std::vector<Mask> heap;
+    Mask* masks;
+
+    explicit _Levels(unsigned count) :
+      masks(local)
+    {
+      if (count > _LOCAL_LEVELS)
+      {
+        heap.resize(count);
+        masks = heap.data();
+      }
+    }
+  };
+
+  BitParallel<SymbolT> _forward;
+  BitParallel<SymbolT> _backward;
+
+public:
+  explicit ApproximateMatcher(PositionAutomaton<SymbolT> const& automaton) :
+    _forward(automaton), _backward(_mirror(automaton))
+  {}
+
+  // the fewest edits that turn the input into a word of the pattern, or
+  // maxErrors + 1 if more are needed
+  unsigned distance(SymbolT const* input, unsigned maxErrors) const
+  {
+    _Levels levels(maxErrors + 1);
+    Mask* r = levels.masks;
+    _start(_forward, r, maxErrors);
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END; i++)
+    {
+      // the levels below the lowest active one stay empty, so it is the
+      // answer once it holds a universal position
+      unsigned lowest = _lowest(r, maxErrors, ~Mask(0));
+      if (lowest > maxErrors)
+      {
+        return lowest;
+      }
+      if (r[lowest] & _forward.getUniversalMask())
+      {
+        return lowest;
+      }
+      _step(_forward, r, maxErrors, input[i], 0);
+    }
+    return _lowest(r, maxErrors, _forward.getFinalMask());
+  }
+
+  // Finds the first substring of [input, input + length) to end that
+  // matches within maxErrors edits, and the fewest errors it takes there;
+  // it starts as far left as these errors allow.
+  bool search(SymbolT const* input, size_t length, unsigned maxErrors,
+    Span& span, unsigned& errors) const
+  {
+    _Levels levels(maxErrors + 1);
+    Mask* r = levels.masks;
+    Mask initial = _forward.getInitialMask();
+    _start(_forward, r, maxErrors);
+
+    // an occurrence may start anywhere: the initial position stays active
+    size_t end = 0;
+    errors = _lowest(r, maxErrors, _forward.getFinalMask());
+    for (; errors > maxErrors && end < length; end++)
+    {
+      _step(_forward, r, maxErrors, input[end], initial);
+      errors = _lowest(r, maxErrors, _forward.getFinalMask());
+    }
+    if (errors > maxErrors)
+    {
+      return false;
+    }
+
+    _start(_backward, r, errors);
+    Mask first = _backward.getFinalMask();
+    size_t begin = end;
+    for (size_t i = end; i > 0 && _lowest(r, errors, ~Mask(0)) <= errors; i--)
+    {
+      if (r[errors] & first)
+      {
+        begin = i;
+      }
+      _step(_backward, r, errors, input[i - 1], 0);
+    }
+    if (r[errors] & first)
+    {
+      begin = 0;
+    }
+    span.begin = begin;
+    span.end = end;
+    return true;
+  }
+
+private:
+  // from the initial position, with up to j deletions at the level j
+  static void _start(BitParallel<SymbolT> const& automaton, Mask* r,
+    unsigned maxErrors)
+  {
+    r[0] = automaton.getInitialMask();
+    for (unsigned j = 1; j <= maxErrors; j++)
+    {
+      r[j] = r[j - 1] | automaton.follow(r[j - 1]);
+    }
+  }
+
+  static void _step(BitParallel<SymbolT> const& automaton, Mask* r,
+    unsigned maxErrors, SymbolT symbol, Mask restart)
+  {
+    Mask symbolMask = automaton.symbolMask(symbol);
+    Mask previous = r[0];
+    Mask previousFollow = automaton.follow(previous);
+    r[0] = (previousFollow & symbolMask) | restart;
+    for (unsigned j = 1; j <= maxErrors; j++)
+    {
+      Mask current = r[j];
+      Mask currentFollow = automaton.follow(current);
+      r[j] = (currentFollow & symbolMask) | previous | previousFollow
+        | r[j - 1] | automaton.follow(r[j - 1]);
+      previous = current;
+      previousFollow = currentFollow;
+    }
+  }
+
+  // the lowest level with a position of the mask, maxErrors + 1 if none
+  static unsigned _lowest(Mask const* r, unsigned maxErrors, Mask mask)
+  {
+    unsigned j = 0;
+    while (j <= maxErrors && (r[j] & mask) == 0)
+    {
+      j++;
+    }
+    return j;
+  }
+
+  // The automaton of the mirror language, on the same positions: entering
+  // a position still reads its symbol. It starts on the former last
+  // positions and accepts on the former first ones.
+  static PositionAutomaton<SymbolT> _mirror(PositionAutomaton<SymbolT> const& automaton)
+  {
+    typedef PositionAutomaton<SymbolT> Automaton;
+
+    Automaton mirror;
+    for (size_t p = 1; p < automaton.size(); p++)
+    {
+      mirror.addPosition(automaton.symbolOf(p));
+    }
+    Mask initial = Automaton::bit(0);
+    mirror.addFollow(0, automaton.getFinalMask() & ~initial);
+    for (size_t p = 1; p < automaton.size(); p++)
+    {
+      for (size_t q = 1; q < automaton.size(); q++)
+      {
+        if (automaton.getFollow(p) & Automaton::bit(q))
+        {
+          mirror.addFollow(q, Automaton::bit(p));
+        }
+      }
+    }
+    mirror.setFinalMask(automaton.getFollow(0)
+      | (automaton.getFinalMask() & initial));
+    return mirror;
+  }
+};
+
+template <typename SymbolT>
+const unsigned ApproximateMatcher<SymbolT>::_LOCAL_LEVELS;
+
+#endif // APPROXIMATE_MATCHER_H
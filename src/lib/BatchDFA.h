@@ -0,0 +1,146 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef BATCH_DFA_H
+#define BATCH_DFA_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+
+#include "DFA.h"
+
+// Runs a DFA over a batch of short inputs, LANES at a time in lock step:
+// the lanes do not depend on each other, so their table loads overlap
+// instead of each waiting for the previous one. The DFA ids are premultiplied
+// (see DFA), so that a step is one add and one load; with AVX2 and byte
+// symbols, the eight lanes step with two gathers. A decided state is
+// absorbing as far as the verdict goes, so the lanes never stop early.
+template <typename SymbolT>
+class BatchDFA
+{
+public:
+  static const size_t LANES = 8;
+
+private:
+  DFA<SymbolT> _dfa;
+
+public:
+  BatchDFA() = default;
+
+  explicit BatchDFA(DFA<SymbolT> const& dfa) :
+    _dfa(dfa)
+  {}
+
+  // results[i] tells whether the DFA accepts the lengths[i] symbols of
+  // inputs[i].
+  void accepts(SymbolT const* const* inputs, size_t const* lengths,
+    size_t count, bool* results) const
+  {
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES)
+    {
+      _acceptsLanes(inputs + i, lengths + i, results + i);
+    }
+    for (; i < count; i++)
+    {
+      DStateId state = _run(_dfa.getInitial(), inputs[i], 0, lengths[i]);
+      results[i] = _dfa.isAcceptor(state);
+    }
+  }
+
+private:
+  DStateId _run(DStateId state, SymbolT const* input, size_t from, size_t to) const
+  {
+    DStateId const* table = _dfa.table();
+    for (size_t i = from; i < to; i++)
+    {
+      state = table[state + _dfa.columnOf(input[i])];
+    }
+    return state;
+  }
+
+  void _acceptsLanes(SymbolT const* const* inputs, size_t const* lengths,
+    bool* results) const
+  {
+    size_t common = *std::min_element(lengths, lengths + LANES);
+    DStateId const* table = _dfa.table();
+    DStateId states[LANES];
+    std::fill(states, states + LANES, _dfa.getInitial());
+
+    if (!_gather(inputs, common, states))
+    {
+      for (size_t i = 0; i < common; i++)
+      {
+        for (size_t lane = 0; lane < LANES; lane++)
+        {
+          states[lane] = table[states[lane] + _dfa.columnOf(inputs[lane][i])];
+        }
+      }
+    }
+
+    for (size_t lane = 0; lane < LANES; lane++)
+    {
+      states[lane] = _run(states[lane], inputs[lane], common, lengths[lane]);
+      results[lane] = _dfa.isAcceptor(states[lane]);
+    }
+  }
+
+  // runs the first 'length' symbols of the eight lanes with AVX2, if
+  // available for these symbols
+  bool _gather(SymbolT const* const* inputs, size_t length, DStateId* states) const
+  {
+#if defined(__AVX2__)
+    if (!SymbolClasses<SymbolT>::DENSE || LANES != 8 || sizeof(DStateId) != 4
+      || _dfa.size() * _dfa.stride() > INT32_MAX)
+    {
+      return false;
+    }
+    auto table = reinterpret_cast<int const*>(_dfa.table());
+    auto columns = reinterpret_cast<int const*>(_dfa.getClasses().byteClasses());
+    auto bytes = reinterpret_cast<unsigned char const* const*>(inputs);
+    __m256i current = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(states));
+    for (size_t i = 0; i < length; i++)
+    {
+      __m256i symbols = _mm256_setr_epi32(bytes[0][i], bytes[1][i], bytes[2][i],
+        bytes[3][i], bytes[4][i], bytes[5][i], bytes[6][i], bytes[7][i]);
+      __m256i column = _mm256_i32gather_epi32(columns, symbols, 4);
+      current = _mm256_i32gather_epi32(table, _mm256_add_epi32(current, column), 4);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(states), current);
+    return true;
+#else
+    (void) inputs;
+    (void) length;
+    (void) states;
+    return false;
+#endif
+  }
+};
+
+template <typename SymbolT>
+const size_t BatchDFA<SymbolT>::LANES;
+
+#endif // BATCH_DFA_H
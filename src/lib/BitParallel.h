@@ -0,0 +1,186 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef BIT_PARALLEL_H
+#define BIT_PARALLEL_H
+
+#include <set>
+#include <vector>
+
+#include "Lexemes.h"
+#include "PositionAutomaton.h"
+#include "SymbolClasses.h"
+
+// Simulates a position automaton with one machine word as the set of active
+// states (Navarro and Raffinot's extension of Shift-And to regular
+// expressions). A step is D' = Follow(D) & B[symbol], where Follow(D) is
+// read from one 256-entry table per byte of D. The scan stops once no
+// position is active, or a universal one is (e.g. the one of a trailing .*).
+template <typename SymbolT>
+class BitParallel
+{
+public:
+  typedef typename PositionAutomaton<SymbolT>::Mask Mask;
+
+private:
+  static const size_t _BYTE_VALUES = 256;
+
+  size_t _chunks = 0;
+  std::vector<Mask> _followTables;
+
+  SymbolClasses<SymbolT> _classes;
+  std::vector<Mask> _symbolMasks; // by class
+
+  Mask _final = 0;
+  Mask _universal = 0;
+
+public:
+  BitParallel() = default;
+
+  explicit BitParallel(PositionAutomaton<SymbolT> const& automaton)
+  {
+    _buildFollowTables(automaton);
+    _buildSymbolMasks(automaton);
+    _final = automaton.getFinalMask();
+    _findUniversalPositions(automaton);
+  }
+
+  Mask getUniversalMask() const
+  {
+    return _universal;
+  }
+
+  Mask getInitialMask() const
+  {
+    return PositionAutomaton<SymbolT>::bit(0);
+  }
+
+  Mask getFinalMask() const
+  {
+    return _final;
+  }
+
+  Mask follow(Mask positions) const
+  {
+    Mask result = 0;
+    for (size_t i = 0; i < _chunks; i++)
+    {
+      result |= _followTables[i * _BYTE_VALUES + ((positions >> (8 * i)) & 0xff)];
+    }
+    return result;
+  }
+
+  Mask symbolMask(SymbolT symbol) const
+  {
+    return _symbolMasks[_classes.classOf(symbol)];
+  }
+
+  bool match(SymbolT const* input) const
+  {
+    Mask active = getInitialMask();
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END && active != 0
+      && (active & _universal) == 0; i++)
+    {
+      active = follow(active) & symbolMask(input[i]);
+    }
+    return (active & _final) != 0;
+  }
+
+private:
+  // greatest set of final positions that follow, on every symbol but the end
+  // of input, a position of the set
+  void _findUniversalPositions(PositionAutomaton<SymbolT> const& automaton)
+  {
+    SymbolRanges<SymbolT> all(SymbolRanges<SymbolT>::min(), SymbolRanges<SymbolT>::max());
+    _universal = _final;
+    for (bool changed = true; changed; )
+    {
+      changed = false;
+      for (size_t p = 0; p < automaton.size(); p++)
+      {
+        if ((_universal & automaton.bit(p)) == 0)
+        {
+          continue;
+        }
+        SymbolRanges<SymbolT> covered(Lexemes<SymbolT>::END, Lexemes<SymbolT>::END);
+        Mask follow = automaton.getFollow(p) & _universal;
+        for (size_t q = 1; q < automaton.size(); q++)
+        {
+          if (follow & automaton.bit(q))
+          {
+            covered.add(automaton.symbolOf(q));
+          }
+        }
+        if (!(covered == all))
+        {
+          _universal &= ~automaton.bit(p);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  void _buildFollowTables(PositionAutomaton<SymbolT> const& automaton)
+  {
+    _chunks = (automaton.size() + 7) / 8;
+    _followTables.assign(_chunks * _BYTE_VALUES, 0);
+    for (size_t i = 0; i < _chunks; i++)
+    {
+      for (size_t byte = 0; byte < _BYTE_VALUES; byte++)
+      {
+        Mask& entry = _followTables[i * _BYTE_VALUES + byte];
+        for (size_t bit = 0; bit < 8; bit++)
+        {
+          size_t position = 8 * i + bit;
+          if ((byte & (1 << bit)) && position < automaton.size())
+          {
+            entry |= automaton.getFollow(position);
+          }
+        }
+      }
+    }
+  }
+
+  void _buildSymbolMasks(PositionAutomaton<SymbolT> const& automaton)
+  {
+    std::set<SymbolT> starts;
+    for (size_t p = 1; p < automaton.size(); p++)
+    {
+      SymbolClasses<SymbolT>::split(starts, automaton.symbolOf(p));
+    }
+    _classes = SymbolClasses<SymbolT>(starts);
+
+    _symbolMasks.assign(_classes.size(), 0);
+    for (size_t cls = 0; cls < _classes.size(); cls++)
+    {
+      SymbolT symbol = _classes.representative(cls);
+      for (size_t p = 1; p < automaton.size(); p++)
+      {
+        if (automaton.symbolOf(p).contains(symbol))
+        {
+          _symbolMasks[cls] |= automaton.bit(p);
+        }
+      }
+    }
+  }
+};
+
+#endif // BIT_PARALLEL_H
@@ -0,0 +1,161 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef BOUNDED_BACKTRACKER_H
+#define BOUNDED_BACKTRACKER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "PikeVM.h"
+#include "Span.h"
+
+// Extracts the capture groups of a short match by backtracking over the
+// PikeVM program, in the priority order of the PikeVM. Each (instruction,
+// position) pair is explored at most once, as recorded in a bit set, so the
+// cost is O(program x span) in the worst case; and since the bit set lives
+// on the stack, a call does not allocate beyond its first one. The captures
+// are those of the PikeVM. Only for the spans which fit(), i.e. when the bit
+// set holds at most MAX_VISITED bits.
+template <typename SymbolT>
+class BoundedBacktracker
+{
+public:
+  static const size_t MAX_VISITED = 16 * 1024;
+
+private:
+  typedef PikeVM<SymbolT> _VM;
+
+  static const size_t _UNSET = static_cast<size_t>(-1);
+  static const size_t _WORD_BITS = 64;
+
+  // explore 'pc' at 'position', or give 'slot' back 'position'
+  struct _Job
+  {
+    bool restore;
+    unsigned pc;
+    unsigned slot;
+    size_t position;
+  };
+
+  std::vector<_Job> _jobs;
+  std::vector<size_t> _slots;
+
+public:
+  static bool fits(_VM const& vm, Span const& span)
+  {
+    return vm.getProgram().size() * (span.length() + 1) <= MAX_VISITED;
+  }
+
+  // same contract as PikeVM::match(), for a span which fits()
+  bool match(_VM const& vm, SymbolT const* input, Span const& span,
+    std::vector<Span>& groups)
+  {
+    auto const& program = vm.getProgram();
+    size_t width = span.length() + 1;
+    uint64_t visited[MAX_VISITED / _WORD_BITS];
+    std::fill(visited, visited + (program.size() * width + _WORD_BITS - 1) / _WORD_BITS, 0);
+
+    _slots.assign(2 * (vm.groupCount() + 1), _UNSET);
+    _jobs.clear();
+    _jobs.push_back(_Job { false, vm.getStart(), 0, span.begin });
+    while (!_jobs.empty())
+    {
+      _Job job = _jobs.back();
+      _jobs.pop_back();
+      if (job.restore)
+      {
+        _slots[job.slot] = job.position;
+        continue;
+      }
+
+      // follows the highest priority path, and leaves the others as jobs
+      unsigned pc = job.pc;
+      size_t position = job.position;
+      for (;;)
+      {
+        size_t bit = pc * width + (position - span.begin);
+        if (visited[bit / _WORD_BITS] & (uint64_t(1) << (bit % _WORD_BITS)))
+        {
+          break;
+        }
+        visited[bit / _WORD_BITS] |= uint64_t(1) << (bit % _WORD_BITS);
+
+        auto const& instruction = program[pc];
+        if (instruction.op == _VM::SPLIT)
+        {
+          _jobs.push_back(_Job { false, instruction.alternative, 0, position });
+        }
+        else if (instruction.op == _VM::SAVE)
+        {
+          _jobs.push_back(_Job { true, 0, instruction.slot, _slots[instruction.slot] });
+          _slots[instruction.slot] = position;
+        }
+        else if (instruction.op == _VM::MATCH)
+        {
+          if (position == span.end)
+          {
+            _output(span, groups);
+            return true;
+          }
+          break;
+        }
+        else if (position < span.end && instruction.reads(input[position]))
+        {
+          position++;
+        }
+        else
+        {
+          break;
+        }
+        pc = instruction.next;
+      }
+    }
+    return false;
+  }
+
+private:
+  void _output(Span const& span, std::vector<Span>& groups) const
+  {
+    groups.assign(_slots.size() / 2, Span::unset());
+    groups[0] = span;
+    for (size_t i = 1; i < groups.size(); i++)
+    {
+      if (_slots[2 * i] != _UNSET && _slots[2 * i + 1] != _UNSET)
+      {
+        groups[i].begin = _slots[2 * i];
+        groups[i].end = _slots[2 * i + 1];
+      }
+    }
+  }
+};
+
+template <typename SymbolT>
+const size_t BoundedBacktracker<SymbolT>::MAX_VISITED;
+
+template <typename SymbolT>
+const size_t BoundedBacktracker<SymbolT>::_UNSET;
+
+template <typename SymbolT>
+const size_t BoundedBacktracker<SymbolT>::_WORD_BITS;
+
+#endif // BOUNDED_BACKTRACKER_H
@@ -0,0 +1,96 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef COMPILE_ALL_H
+#define COMPILE_ALL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CompileOptions.h"
+
+// The outcome of the compilation of one pattern by compileAll().
+template <typename RegexT>
+struct Compiled
+{
+  std::unique_ptr<RegexT> regex; // null if the pattern did not compile
+  std::string error;
+};
+
+// Compiles every pattern into a RegexT (Regex, WRegex, ...) on 'threads'
+// threads, or on as many as the hardware runs at once if 0. The patterns
+// are handed out in batches, so that a few slow ones do not hold a whole
+// share of the work. A pattern that does not compile does not stop the
+// others: its regex is null and its error is kept.
+template <typename RegexT, typename StringT>
+std::vector<Compiled<RegexT>> compileAll(std::vector<StringT> const& patterns,
+  CompileOptions const& options=CompileOptions(), unsigned threads=0)
+{
+  static const size_t BATCH_SIZE = 64;
+
+  std::vector<Compiled<RegexT>> results(patterns.size());
+  std::atomic<size_t> next(0);
+
+  auto work = [&] () {
+    for (size_t begin = next.fetch_add(BATCH_SIZE); begin < patterns.size();
+      begin = next.fetch_add(BATCH_SIZE))
+    {
+      size_t end = std::min(begin + BATCH_SIZE, patterns.size());
+      for (size_t i = begin; i < end; i++)
+      {
+        try
+        {
+          results[i].regex.reset(new RegexT(patterns[i], options));
+        }
+        catch (std::exception const& e)
+        {
+          results[i].error = e.what();
+        }
+      }
+    }
+  };
+
+  if (threads == 0)
+  {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t batches = (patterns.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+  threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, batches)));
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threads; i++)
+  {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  return results;
+}
+
+#endif // COMPILE_ALL_H
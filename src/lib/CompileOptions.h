@@ -0,0 +1,157 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef COMPILE_OPTIONS_H
+#define COMPILE_OPTIONS_H
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+// Limits and tuning of the compilation of a regex. A limit set to 0 means
+// "unlimited".
+struct CompileOptions
+{
+  enum Engine
+  {
+    AUTO,
+    LITERAL,
+    AHO_CORASICK,
+    BIT_PARALLEL,
+    EAGER_DFA,
+    LAZY_DFA
+  };
+
+  // AUTO lets the Planner choose from the pattern
+  Engine engine = AUTO;
+
+  // fail with a ComplexityError beyond these ones
+  size_t maxNFAStates = 0;
+  std::chrono::milliseconds maxCompileTime = std::chrono::milliseconds(0);
+
+  // The DFA is determinized up front while it has at most maxDFAStates
+  // states. Beyond, the regex degrades to the lazy DFA, unless failOnDFAStates
+  // is set. 0 disables the up-front determinization.
+  size_t maxDFAStates = 512;
+  bool failOnDFAStates = false;
+
+  // memory budget of the lazy DFA cache, which the threads share, in bytes
+  size_t cacheBudget = 1 << 20;
+
+  // simplify the pattern before building its automaton (see Optimizer)
+  bool optimize = true;
+
+  // The pattern and the inputs are UTF-8: symbols, classes and '.' stand for
+  // whole code points, and the automata run on the bytes. char regexes only.
+  bool utf8 = false;
+
+  static char const* toString(Engine engine)
+  {
+    switch (engine)
+    {
+      case AUTO:          return "auto";
+      case LITERAL:       return "literal";
+      case AHO_CORASICK:  return "aho-corasick";
+      case BIT_PARALLEL:  return "bit-parallel";
+      case EAGER_DFA:     return "dfa";
+      case LAZY_DFA:      return "lazy-dfa";
+    }
+    return "unknown";
+  }
+};
+
+class ComplexityError : public std::runtime_error
+{
+public:
+  enum Limit { NFA_STATES, DFA_STATES, COMPILE_TIME };
+
+private:
+  Limit _limit;
+
+public:
+  explicit ComplexityError(Limit limit) :
+    std::runtime_error(_describe(limit)), _limit(limit)
+  {}
+
+  Limit getLimit() const
+  {
+    return _limit;
+  }
+
+private:
+  static std::string _describe(Limit limit)
+  {
+    switch (limit)
+    {
+      case NFA_STATES:    return "too many NFA states";
+      case DFA_STATES:    return "too many DFA states";
+      case COMPILE_TIME:  return "compilation took too long";
+    }
+    return "too complex";
+  }
+};
+
+// Enforces the limits of a CompileOptions during one compilation.
+class CompileBudget
+{
+private:
+  typedef std::chrono::steady_clock _Clock;
+
+  CompileOptions const& _options;
+  _Clock::time_point _deadline;
+
+public:
+  explicit CompileBudget(CompileOptions const& options) :
+    _options(options),
+    _deadline(_Clock::now() + options.maxCompileTime)
+  {}
+
+  CompileOptions const& getOptions() const
+  {
+    return _options;
+  }
+
+  void checkNFAStates(size_t count) const
+  {
+    if (_options.maxNFAStates != 0 && count > _options.maxNFAStates)
+    {
+      throw ComplexityError(ComplexityError::NFA_STATES);
+    }
+  }
+
+  void checkDFAStates(size_t count) const
+  {
+    if (_options.maxDFAStates != 0 && count > _options.maxDFAStates)
+    {
+      throw ComplexityError(ComplexityError::DFA_STATES);
+    }
+  }
+
+  void checkTime() const
+  {
+    if (_options.maxCompileTime.count() != 0 && _Clock::now() > _deadline)
+    {
+      throw ComplexityError(ComplexityError::COMPILE_TIME);
+    }
+  }
+};
+
+#endif // COMPILE_OPTIONS_H
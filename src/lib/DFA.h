@@ -0,0 +1,414 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef DFA_H
+#define DFA_H
+
+#include <cassert>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Lexemes.h"
+#include "SymbolClasses.h"
+#include "AlignedAllocator.h"
+
+typedef unsigned int DStateId;
+
+// A complete deterministic automaton stored as a transition table, with one
+// column per class of symbols.
+//
+// The table is laid out for the scanning loops:
+//  - a state id is the offset of its row (premultiplied), so a step is
+//    _table[id + column], without a multiply;
+//  - the rows are padded to a power of two or to a whole number of cache
+//    lines, and the table starts on a cache line, so that a row never
+//    straddles more lines than needed;
+//  - once finished, the states are renumbered in breadth-first order from
+//    the initial one, or by how often a corpus visits them (see reorder()),
+//    and grouped so that acceptors and decided states are ranges of ids:
+//    the scanning loops test them with comparisons instead of loads.
+template <typename SymbolT>
+class DFA
+{
+public:
+  static const size_t CACHE_LINE = 64;
+
+private:
+  typedef std::vector<DStateId, AlignedAllocator<DStateId, CACHE_LINE>> _Table;
+
+  static const size_t _LINE_COLUMNS = CACHE_LINE / sizeof(DStateId);
+
+  SymbolClasses<SymbolT> _classes;
+  size_t _columns;
+  size_t _stride;
+  _Table _table;
+  DStateId _initialState = 0;
+
+  // by row; the rows are ordered: the undecided non-acceptors, the
+  // undecided acceptors, the decided acceptors (accept-forever) and the
+  // decided non-acceptors (dead). The bounds are ids.
+  std::vector<bool> _acceptors;
+  std::vector<bool> _decided;
+  DStateId _acceptorsBegin = 0;
+  DStateId _decidedBegin = 0;
+  DStateId _deadBegin = 0;
+
+  // by row, what each acceptor accepts (see setTag()); empty if untagged
+  std::vector<unsigned> _tags;
+
+public:
+  DFA() :
+    DFA(SymbolClasses<SymbolT>())
+  {}
+
+  explicit DFA(SymbolClasses<SymbolT> const& classes) :
+    _classes(classes), _columns(classes.size()), _stride(_strideOf(_columns))
+  {}
+
+  size_t size() const
+  {
+    return _acceptors.size();
+  }
+
+  size_t columns() const
+  {
+    return _columns;
+  }
+
+  // the distance between two rows: the id of a state is its row times the
+  // stride
+  size_t stride() const
+  {
+    return _stride;
+  }
+
+  // _table()[id + columnOf(symbol)] is next(id, symbol)
+  DStateId const* table() const
+  {
+    return _table.data();
+  }
+
+  SymbolClasses<SymbolT> const& getClasses() const
+  {
+    return _classes;
+  }
+
+  DStateId getInitial() const
+  {
+    return _initialState;
+  }
+
+  void replaceInitial(DStateId id)
+  {
+    assert(id % _stride == 0 && id / _stride < size());
+    _initialState = id;
+  }
+
+  bool isAcceptor(DStateId id) const
+  {
+    return id >= _acceptorsBegin && id < _deadBegin;
+  }
+
+  bool isDecided(DStateId id) const
+  {
+    return id >= _decidedBegin;
+  }
+
+  bool isDead(DStateId id) const
+  {
+    return id >= _deadBegin;
+  }
+
+  // Tags a state, e.g. with the token an acceptor of a TokenizerBase
+  // stands for. The tags follow the states when they are renumbered.
+  void setTag(DStateId id, unsigned tag)
+  {
+    assert(id % _stride == 0 && id / _stride < size());
+    _tags.resize(size(), 0);
+    _tags[id / _stride] = tag;
+  }
+
+  unsigned getTag(DStateId id) const
+  {
+    return _tags.empty() ? 0 : _tags[id / _stride];
+  }
+
+  // The new state loops on itself until its transitions are set. Its id is
+  // only stable until finish().
+  DStateId addState(bool acceptor)
+  {
+    if (_table.size() + _stride > std::numeric_limits<DStateId>::max())
+    {
+      throw std::length_error("too many DFA states");
+    }
+    DStateId id = static_cast<DStateId>(_table.size());
+    _acceptors.push_back(acceptor);
+    _decided.push_back(false);
+    if (!_tags.empty())
+    {
+      _tags.push_back(0);
+    }
+    _table.insert(_table.end(), _stride, id);
+    return id;
+  }
+
+  size_t columnOf(SymbolT symbol) const
+  {
+    return _classes.classOf(symbol);
+  }
+
+  void setTransition(DStateId src, size_t column, DStateId dst)
+  {
+    assert(src / _stride < size() && dst / _stride < size() && column < _columns);
+    _table[src + column] = dst;
+  }
+
+  DStateId next(DStateId id, SymbolT symbol) const
+  {
+    return _table[id + columnOf(symbol)];
+  }
+
+  // Finds the decided states once every transition is set, then renumbers
+  // the states in breadth-first order. The ids given so far are invalid.
+  void finish()
+  {
+    _findDecidedStates();
+    _renumber(_breadthFirst());
+  }
+
+  // Counts the visits of each row (id / stride) while running the input.
+  void countVisits(SymbolT const* input, std::vector<size_t>& visits) const
+  {
+    visits.resize(size(), 0);
+    DStateId current = _initialState;
+    visits[current / _stride]++;
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END
+      && !isDecided(current); i++)
+    {
+      current = next(current, input[i]);
+      visits[current / _stride]++;
+    }
+  }
+
+  // Renumbers the states from the most visited to the least (see
+  // countVisits()), breadth-first among equals, so that the hot rows share
+  // the cache lines and the pages. The ids given so far are invalid.
+  void reorder(std::vector<size_t> const& visits)
+  {
+    assert(visits.size() == size());
+    std::vector<size_t> order = _breadthFirst();
+    std::stable_sort(order.begin(), order.end(), [&] (size_t a, size_t b) {
+      return visits[a] > visits[b];
+    });
+    _renumber(order);
+  }
+
+  bool accepts(SymbolT const* input) const
+  {
+    DStateId const* table = _table.data();
+    DStateId current = _initialState;
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END
+      && current < _decidedBegin; i++)
+    {
+      current = table[current + columnOf(input[i])];
+    }
+    return isAcceptor(current);
+  }
+
+private:
+  static size_t _strideOf(size_t columns)
+  {
+    size_t stride = 1;
+    while (stride < columns && stride < _LINE_COLUMNS)
+    {
+      stride *= 2;
+    }
+    return stride < columns
+      ? (columns + _LINE_COLUMNS - 1) / _LINE_COLUMNS * _LINE_COLUMNS
+      : stride;
+  }
+
+  DStateId _target(size_t row, size_t column) const
+  {
+    return _table[row * _stride + column];
+  }
+
+  void _findDecidedStates()
+  {
+    // a column of the end of input alone is never read
+    SymbolT end = Lexemes<SymbolT>::END;
+    size_t endColumn = columnOf(end);
+    bool endAlone = (end == SymbolRanges<SymbolT>::min()
+        || columnOf(static_cast<SymbolT>(end - 1)) != endColumn)
+      && (end == SymbolRanges<SymbolT>::max()
+        || columnOf(static_cast<SymbolT>(end + 1)) != endColumn);
+
+    std::vector<std::vector<size_t>> predecessors(size());
+    for (size_t row = 0; row < size(); row++)
+    {
+      for (size_t column = 0; column < _columns; column++)
+      {
+        if (!endAlone || column != endColumn)
+        {
+          predecessors[_target(row, column) / _stride].push_back(row);
+        }
+      }
+    }
+
+    std::vector<bool> reachAcceptor = _reaching(predecessors, true);
+    std::vector<bool> reachNonAcceptor = _reaching(predecessors, false);
+    for (size_t row = 0; row < size(); row++)
+    {
+      _decided[row] = !reachAcceptor[row] || !reachNonAcceptor[row];
+    }
+  }
+
+  // the states that can reach an acceptor, or a non-acceptor if !acceptor
+  std::vector<bool> _reaching(std::vector<std::vector<size_t>> const& predecessors,
+    bool acceptor) const
+  {
+    std::vector<bool> result(size(), false);
+    std::vector<size_t> stack;
+    for (size_t row = 0; row < size(); row++)
+    {
+      if (_acceptors[row] == acceptor)
+      {
+        result[row] = true;
+        stack.push_back(row);
+      }
+    }
+    while (!stack.empty())
+    {
+      size_t row = stack.back();
+      stack.pop_back();
+      for (auto predecessor : predecessors[row])
+      {
+        if (!result[predecessor])
+        {
+          result[predecessor] = true;
+          stack.push_back(predecessor);
+        }
+      }
+    }
+    return result;
+  }
+
+  // the rows from the initial one, then the unreachable ones
+  std::vector<size_t> _breadthFirst() const
+  {
+    std::vector<size_t> order;
+    std::vector<bool> seen(size(), false);
+    for (size_t root = 0; root <= size(); root++)
+    {
+      size_t start = root == 0 ? _initialState / _stride : root - 1;
+      if (start >= size() || seen[start])
+      {
+        continue;
+      }
+      seen[start] = true;
+      order.push_back(start);
+      for (size_t i = order.size() - 1; i < order.size(); i++)
+      {
+        for (size_t column = 0; column < _columns; column++)
+        {
+          size_t target = _target(order[i], column) / _stride;
+          if (!seen[target])
+          {
+            seen[target] = true;
+            order.push_back(target);
+          }
+        }
+      }
+    }
+    return order;
+  }
+
+  unsigned _group(size_t row) const
+  {
+    return _decided[row] ? (_acceptors[row] ? 2 : 3) : (_acceptors[row] ? 1 : 0);
+  }
+
+  // order[i] is the old row of the new row i; it keeps its place in its
+  // group
+  void _renumber(std::vector<size_t> order)
+  {
+    std::stable_sort(order.begin(), order.end(), [this] (size_t a, size_t b) {
+      return _group(a) < _group(b);
+    });
+
+    std::vector<DStateId> ids(size());
+    for (size_t row = 0; row < size(); row++)
+    {
+      ids[order[row]] = static_cast<DStateId>(row * _stride);
+    }
+
+    _Table table(_table.size());
+    std::vector<bool> acceptors(size());
+    std::vector<bool> decided(size());
+    std::vector<unsigned> tags(_tags.size());
+    // bounds[g] is the first row of a group >= g
+    DStateId end = static_cast<DStateId>(_table.size());
+    DStateId bounds[4] = {end, end, end, end};
+    for (size_t row = size(); row-- > 0; )
+    {
+      size_t old = order[row];
+      for (size_t column = 0; column < _stride; column++)
+      {
+        table[row * _stride + column] = column < _columns
+          ? ids[_target(old, column) / _stride]
+          : ids[old];
+      }
+      acceptors[row] = _acceptors[old];
+      decided[row] = _decided[old];
+      if (!tags.empty())
+      {
+        tags[row] = _tags[old];
+      }
+      for (unsigned group = 0; group <= _group(old); group++)
+      {
+        bounds[group] = static_cast<DStateId>(row * _stride);
+      }
+    }
+    if (size() != 0)
+    {
+      _initialState = ids[_initialState / _stride];
+    }
+
+    _table.swap(table);
+    _acceptors.swap(acceptors);
+    _decided.swap(decided);
+    _tags.swap(tags);
+    _acceptorsBegin = bounds[1];
+    _decidedBegin = bounds[2];
+    _deadBegin = bounds[3];
+  }
+};
+
+template <typename SymbolT>
+const size_t DFA<SymbolT>::CACHE_LINE;
+
+template <typename SymbolT>
+const size_t DFA<SymbolT>::_LINE_COLUMNS;
+
+#endif // DFA_H
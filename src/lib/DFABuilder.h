@@ -0,0 +1,150 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef DFA_BUILDER_H
+#define DFA_BUILDER_H
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "NFA.h"
+#include "DFA.h"
+#include "SymbolClasses.h"
+#include "CompileOptions.h"
+
+// Subset construction (Dragon Book, Fig 3.32), on one representative symbol
+// per class of symbols (see SymbolClasses). The budget, if any, bounds the
+// number of DFA states and the time spent; ComplexityError is thrown beyond.
+// The dead and accept-forever states of the result are marked, and its states
+// are laid out breadth-first (see DFA::finish()). Given the tag of each NFA
+// state, an acceptor of the DFA is tagged with the lowest tag of its NFA
+// acceptors (see DFA::setTag()): the first of the patterns it accepts.
+template <typename SymbolT>
+class DFABuilder
+{
+private:
+  NFA<SymbolT> const& _nfa;
+  DFA<SymbolT>& _dfa;
+  CompileBudget const* _budget;
+  std::vector<unsigned> const* _tags;
+
+  std::map<std::vector<StateId>, DStateId> _index;
+  std::vector<std::vector<StateId>> _sets;
+  std::vector<DStateId> _ids; // of the sets
+  std::vector<bool> _marks;
+
+public:
+  DFABuilder(NFA<SymbolT> const& nfa, DFA<SymbolT>& dfa,
+    CompileBudget const* budget=nullptr, std::vector<unsigned> const* tags=nullptr) :
+    _nfa(nfa), _dfa(dfa), _budget(budget), _tags(tags)
+  {
+    _build();
+  }
+
+  DFA<SymbolT>& collect()
+  {
+    return _dfa;
+  }
+
+  DFA<SymbolT> const& collect() const
+  {
+    return _dfa;
+  }
+
+private:
+  DStateId _addState(std::vector<StateId>& set)
+  {
+    _nfa.epsilonClosure(set, _marks);
+
+    auto it = _index.find(set);
+    if (it != _index.end())
+    {
+      return it->second;
+    }
+
+    bool acceptor = false;
+    unsigned tag = std::numeric_limits<unsigned>::max();
+    for (auto state : set)
+    {
+      if (_nfa.isAcceptor(state))
+      {
+        acceptor = true;
+        tag = _tags != nullptr ? std::min(tag, (*_tags)[state]) : 0;
+      }
+    }
+
+    DStateId id = _dfa.addState(acceptor);
+    if (_tags != nullptr && acceptor)
+    {
+      _dfa.setTag(id, tag);
+    }
+    if (_budget != nullptr)
+    {
+      _budget->checkDFAStates(_dfa.size());
+      _budget->checkTime();
+    }
+    _index.emplace(set, id);
+    _sets.push_back(set);
+    _ids.push_back(id);
+    return id;
+  }
+
+  std::vector<StateId> _move(std::vector<StateId> const& set, SymbolT symbol)
+  {
+    std::vector<StateId> result;
+    _marks.assign(_nfa.size(), false);
+    for (auto state : set)
+    {
+      _nfa.forEachTransition(state, symbol, [&] (StateId reachable) {
+        if (!_marks[reachable])
+        {
+          _marks[reachable] = true;
+          result.push_back(reachable);
+        }
+      });
+    }
+    return result;
+  }
+
+  void _build()
+  {
+    _dfa = DFA<SymbolT>(SymbolClasses<SymbolT>(_nfa.classStarts()));
+    auto const& classes = _dfa.getClasses();
+
+    std::vector<StateId> initial { _nfa.getInitial() };
+    _dfa.replaceInitial(_addState(initial));
+
+    // _sets grows while it is walked: it is the worklist
+    for (size_t i = 0; i < _sets.size(); i++)
+    {
+      for (size_t cls = 0; cls < classes.size(); cls++)
+      {
+        std::vector<StateId> target = _move(_sets[i], classes.representative(cls));
+        _dfa.setTransition(_ids[i], cls, _addState(target));
+      }
+    }
+    _dfa.finish();
+  }
+};
+
+#endif // DFA_BUILDER_H
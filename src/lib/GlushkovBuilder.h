@@ -0,0 +1,185 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef GLUSHKOV_BUILDER_H
+#define GLUSHKOV_BUILDER_H
+
+#include <vector>
+#include <stack>
+#include <stdexcept>
+
+#include "Token.h"
+#include "PositionAutomaton.h"
+
+// Builds the position automaton of a postfix token list, following the
+// classic first / last / follow / nullable induction.
+template <typename SymbolT>
+class GlushkovBuilder
+{
+private:
+  typedef ::Token<SymbolT> Token;
+  typedef typename PositionAutomaton<SymbolT>::Mask Mask;
+
+  struct _Fragment
+  {
+    bool nullable;
+    Mask first;
+    Mask last;
+  };
+
+  PositionAutomaton<SymbolT>& _automaton;
+  std::stack<_Fragment> _stack;
+
+public:
+  GlushkovBuilder(std::vector<Token> const& npi, PositionAutomaton<SymbolT>& automaton) :
+    _automaton(automaton)
+  {
+    _build(npi);
+  }
+
+  PositionAutomaton<SymbolT>& collect()
+  {
+    return _automaton;
+  }
+
+  // number of positions needed by a postfix token list, the initial one included
+  static size_t countPositions(std::vector<Token> const& npi)
+  {
+    size_t count = 1;
+    for (auto const& token : npi)
+    {
+      if (token.isOperand())
+      {
+        count++;
+      }
+    }
+    return count;
+  }
+
+private:
+  _Fragment _pop()
+  {
+    if (_stack.empty())
+    {
+      throw std::invalid_argument("syntax error");
+    }
+    _Fragment fragment = _stack.top();
+    _stack.pop();
+    return fragment;
+  }
+
+  void _addFollow(Mask from, Mask to)
+  {
+    for (size_t p = 0; p < _automaton.size(); p++)
+    {
+      if (from & _automaton.bit(p))
+      {
+        _automaton.addFollow(p, to);
+      }
+    }
+  }
+
+  void _shunt(Token const& token)
+  {
+    switch (token.getLabel())
+    {
+      case Token::LAMBDA:
+      case Token::CLASS:
+      {
+        SymbolRanges<SymbolT> symbol = token.getLabel() == Token::CLASS
+          ? token.getRanges() : SymbolRanges<SymbolT>(token.getValue(), token.getValue());
+        Mask p = _automaton.bit(_automaton.addPosition(symbol));
+        _stack.push({ false, p, p });
+        break;
+      }
+      case Token::CONCAT:
+      {
+        _Fragment right = _pop();
+        _Fragment left = _pop();
+        _addFollow(left.last, right.first);
+        _stack.push({
+          left.nullable && right.nullable,
+          left.first | (left.nullable ? right.first : 0),
+          right.last | (right.nullable ? left.last : 0)
+        });
+        break;
+      }
+      case Token::OR:
+      {
+        _Fragment right = _pop();
+        _Fragment left = _pop();
+        _stack.push({
+          left.nullable || right.nullable,
+          left.first | right.first,
+          left.last | right.last
+        });
+        break;
+      }
+      case Token::STAR:
+      case Token::PLUS:
+      {
+        _Fragment operand = _pop();
+        _addFollow(operand.last, operand.first);
+        operand.nullable = operand.nullable || token.getLabel() == Token::STAR;
+        _stack.push(operand);
+        break;
+      }
+      case Token::OPTION:
+      {
+        _Fragment operand = _pop();
+        operand.nullable = true;
+        _stack.push(operand);
+        break;
+      }
+      default:
+        throw std::invalid_argument("unexpected token");
+    }
+  }
+
+  void _build(std::vector<Token> const& npi)
+  {
+    if (countPositions(npi) > PositionAutomaton<SymbolT>::MAX_SIZE)
+    {
+      throw std::length_error("too many positions");
+    }
+
+    for (auto const& token : npi)
+    {
+      _shunt(token);
+    }
+
+    _Fragment root { true, 0, 0 };
+    if (_stack.size() == 1)
+    {
+      root = _pop();
+    }
+    else if (!_stack.empty())
+    {
+      throw std::invalid_argument("missing operator(s)");
+    }
+
+    Mask initial = _automaton.bit(0);
+    _automaton.addFollow(0, root.first);
+    _automaton.setFinalMask(root.last | (root.nullable ? initial : 0));
+  }
+};
+
+#endif // GLUSHKOV_BUILDER_H
@@ -0,0 +1,276 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef HOT_SWAP_H
+#define HOT_SWAP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Holds the current version of a value (a Regex, a rule set, ...) that is
+// replaced while other threads keep reading it. A reader pins the current
+// version with read() and keeps it until its Reader is destroyed, without
+// ever taking a lock: a publication swaps the pointer atomically and the
+// versions are reclaimed by epochs. Every publication starts an epoch; a
+// reader counts itself in the epoch it started in (one of two counters,
+// by parity), and the version replaced in an epoch is deleted once the
+// readers of that epoch are gone. Publications are serialized between
+// them and only a publication may wait, for the readers of the epoch
+// before the last one.
+template <typename T>
+class HotSwap
+{
+private:
+  static const size_t _CACHE_LINE = 64;
+  static const size_t _SLOTS = 16;
+
+  // the readers are spread over a few cache lines, by thread
+  struct _Slot
+  {
+    std::atomic<size_t> readers[2];
+    char padding[_CACHE_LINE - 2 * sizeof(std::atomic<size_t>)];
+  };
+
+  std::atomic<T*> _current;
+  std::atomic<size_t> _epoch;
+  _Slot _slots[_SLOTS];
+
+  std::mutex _publishing;
+  std::unique_ptr<T> _retired[2]; // by parity of the epoch that replaced it
+
+  // the reloads still running, which the destructor waits for
+  std::mutex _reloading;
+  std::condition_variable _reloaded;
+  size_t _pendingReloads = 0;
+
+public:
+  class Reader
+  {
+  private:
+    std::atomic<size_t>* _readers;
+    T const* _value;
+
+  public:
+    Reader(std::atomic<size_t>* readers, T const* value) :
+      _readers(readers), _value(value)
+    {}
+
+    Reader(Reader&& other) :
+      _readers(other._readers), _value(other._value)
+    {
+      other._readers = nullptr;
+    }
+
+    Reader(Reader const&) = delete;
+    void operator=(Reader const&) = delete;
+
+    ~Reader()
+    {
+      if (_readers != nullptr)
+      {
+        _readers->fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    T const& operator*() const
+    {
+      return *_value;
+    }
+
+    T const* operator->() const
+    {
+      return _value;
+    }
+  };
+
+public:
+  explicit HotSwap(std::unique_ptr<T> initial) :
+    _current(initial.release()), _epoch(0)
+  {
+    for (auto& slot : _slots)
+    {
+      slot.readers[0].store(0, std::memory_order_relaxed);
+      slot.readers[1].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  explicit HotSwap(T const& initial) :
+    HotSwap(std::unique_ptr<T>(new T(initial)))
+  {}
+
+  HotSwap(HotSwap const&) = delete;
+  void operator=(HotSwap const&) = delete;
+
+  // the readers must be gone; waits for the reloads still running
+  ~HotSwap()
+  {
+    std::unique_lock<std::mutex> lock(_reloading);
+    _reloaded.wait(lock, [this] () { return _pendingReloads == 0; });
+    delete _current.load(std::memory_order_acquire);
+  }
+
+  // the number of publications so far
+  size_t version() const
+  {
+    return _epoch.load(std::memory_order_acquire);
+  }
+
+  Reader read()
+  {
+    _Slot& slot = _slots[std::hash<std::thread::id>()(std::this_thread::get_id())
+      % _SLOTS];
+    for (;;)
+    {
+      size_t epoch = _epoch.load(std::memory_order_seq_cst);
+      std::atomic<size_t>& readers = slot.readers[epoch & 1];
+      readers.fetch_add(1, std::memory_order_seq_cst);
+      // counted in an epoch that is still the current one, the reader
+      // cannot miss the version it replaces
+      if (_epoch.load(std::memory_order_seq_cst) == epoch)
+      {
+        return Reader(&readers, _current.load(std::memory_order_acquire));
+      }
+      readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // the readers already running finish on the previous version
+  void publish(std::unique_ptr<T> value)
+  {
+    std::lock_guard<std::mutex> lock(_publishing);
+    _publish(std::move(value));
+  }
+
+  // Publishes 'value' only if the current version is still 'expected', and
+  // tells whether it did: of the threads that find a version stale at the
+  // same time, one replaces it.
+  bool replace(T const* expected, std::unique_ptr<T> value)
+  {
+    std::lock_guard<std::mutex> lock(_publishing);
+    if (_current.load(std::memory_order_acquire) != expected)
+    {
+      return false;
+    }
+    _publish(std::move(value));
+    return true;
+  }
+
+  // Builds a T from the arguments on another thread and publishes it,
+  // without waiting for it. The future is ready once the new version is
+  // live, or holds the exception thrown by its construction (e.g.
+  // std::invalid_argument for a pattern that does not compile), in which
+  // case the current version stays. It may be dropped: the thread is
+  // detached, unlike that of std::async.
+  template <typename... Args>
+  std::future<void> reload(Args&&... args)
+  {
+    auto published = std::make_shared<std::promise<void>>();
+    std::future<void> future = published->get_future();
+    {
+      std::lock_guard<std::mutex> lock(_reloading);
+      _pendingReloads++;
+    }
+    try
+    {
+      std::thread([this, published] (typename std::decay<Args>::type const&... copies) {
+        try
+        {
+          publish(std::unique_ptr<T>(new T(copies...)));
+          published->set_value();
+        }
+        catch (...)
+        {
+          published->set_exception(std::current_exception());
+        }
+        _endReload();
+      }, std::forward<Args>(args)...).detach();
+    }
+    catch (...)
+    {
+      _endReload();
+      throw;
+    }
+    return future;
+  }
+
+private:
+  // under the publishing lock
+  void _publish(std::unique_ptr<T> value)
+  {
+    size_t epoch = _epoch.load(std::memory_order_relaxed);
+    unsigned parity = epoch & 1;
+
+    // the other parity is about to be reused by the next epoch
+    _waitForReaders(parity ^ 1);
+    _retired[parity ^ 1].reset();
+
+    T* previous = _current.exchange(value.release(), std::memory_order_seq_cst);
+    _epoch.store(epoch + 1, std::memory_order_seq_cst);
+    _retired[parity].reset(previous);
+    if (_readerCount(parity) == 0)
+    {
+      _retired[parity].reset();
+    }
+  }
+
+  void _endReload()
+  {
+    std::lock_guard<std::mutex> lock(_reloading);
+    if (--_pendingReloads == 0)
+    {
+      _reloaded.notify_all();
+    }
+  }
+
+  size_t _readerCount(unsigned parity) const
+  {
+    size_t count = 0;
+    for (auto const& slot : _slots)
+    {
+      count += slot.readers[parity].load(std::memory_order_seq_cst);
+    }
+    return count;
+  }
+
+  void _waitForReaders(unsigned parity) const
+  {
+    while (_readerCount(parity) != 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+};
+
+template <typename T>
+const size_t HotSwap<T>::_CACHE_LINE;
+
+template <typename T>
+const size_t HotSwap<T>::_SLOTS;
+
+#endif // HOT_SWAP_H
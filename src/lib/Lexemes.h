@@ -24,17 +24,25 @@
 
 #include <string>
 
+// The special symbols of the syntax. They are constant expressions, so that
+// the Lexer can switch on them.
 template <typename SymbolT>
 class Lexemes
 {
 public:
-  static SymbolT const STAR;
-  static SymbolT const PLUS;
-  static SymbolT const OR;
-  static SymbolT const OPTION;
-  static SymbolT const LEFT_PARENTH;
-  static SymbolT const RIGHT_PARENTH;
-  static SymbolT const END;
+  static constexpr SymbolT STAR = '*';
+  static constexpr SymbolT PLUS = '+';
+  static constexpr SymbolT OR = '|';
+  static constexpr SymbolT OPTION = '?';
+  static constexpr SymbolT LEFT_PARENTH = '(';
+  static constexpr SymbolT RIGHT_PARENTH = ')';
+  static constexpr SymbolT ANY = '.';
+  static constexpr SymbolT LEFT_BRACKET = '[';
+  static constexpr SymbolT RIGHT_BRACKET = ']';
+  static constexpr SymbolT NEGATION = '^';
+  static constexpr SymbolT RANGE = '-';
+  static constexpr SymbolT ESCAPE = '\\';
+  static constexpr SymbolT END = '\0';
 
 public:
   Lexemes() = delete;
@@ -44,4 +52,32 @@ public:
   static std::string toString(SymbolT);
 };
 
+// the definitions of the constants, for when they are bound to a reference
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::STAR;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::PLUS;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::OR;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::OPTION;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::LEFT_PARENTH;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::RIGHT_PARENTH;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::ANY;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::LEFT_BRACKET;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::RIGHT_BRACKET;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::NEGATION;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::RANGE;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::ESCAPE;
+template <typename SymbolT>
+constexpr SymbolT Lexemes<SymbolT>::END;
+
 #endif // LEXEMES_H
@@ -22,38 +22,41 @@
 #ifndef LEXER_H
 #define LEXER_H
 
-#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include "Lexemes.h"
 #include "Token.h"
+#include "SymbolRanges.h"
 
 template <typename SymbolT>
 class Lexer
 {
 private:
-  typedef Token<SymbolT> Token;
+  typedef ::Token<SymbolT> Token;
 
   SymbolT const* _input;
-  std::list<Token>& _tokenList;
+  std::vector<Token>& _tokenList;
   size_t _index = 0;
   
 public:
-  Lexer(SymbolT const* input, std::list<Token>& output) :
+  Lexer(SymbolT const* input, std::vector<Token>& output) :
     _input(input), _tokenList(output)
   {
     _tokenize();
   }
 
   Lexer(SymbolT const* input) :
-    Lexer(input, *new std::list<Token>)
+    Lexer(input, *new std::vector<Token>)
   {}
 
-  std::list<Token> const& collect() const
+  std::vector<Token> const& collect() const
   {
     return _tokenList;
   }
 
-  std::list<Token>& collect()
+  std::vector<Token>& collect()
   {
     return _tokenList;
   }
@@ -76,6 +79,18 @@ private:
     }
   }
 
+  SymbolT _peekAfterNext() const
+  {
+    if (_peek() != Lexemes<SymbolT>::END)
+    {
+      return _input[_index + 2];
+    }
+    else
+    {
+      return Lexemes<SymbolT>::END;
+    }
+  }
+
   SymbolT _next()
   {
     if (_current() != Lexemes<SymbolT>::END)
@@ -87,7 +102,7 @@ private:
 
   void _product(Token token)
   {
-    _tokenList.push_back(token);
+    _tokenList.push_back(std::move(token));
   }
 
   void _product(typename Token::Label label)
@@ -100,47 +115,210 @@ private:
     _tokenList.emplace_back(label, value);
   }
 
+  // the labels after which an operand starts a concatenation, as a bit set
+  static constexpr unsigned _ENDS_OPERAND = (1u << Token::LAMBDA)
+    | (1u << Token::CLASS) | (1u << Token::STAR) | (1u << Token::RIGHT_PARENTH)
+    | (1u << Token::PLUS) | (1u << Token::OPTION);
+
   void _maybeAddConcat()
   {
-    static const std::set<typename Token::Label> concerned {
-      Token::LAMBDA, Token::STAR, Token::RIGHT_PARENTH,
-      Token::PLUS, Token::OPTION
-    };
-    typename Token::Label label = _tokenList.back().getLabel();
-
-    if (concerned.count(label) == 1)
-    { 
+    if (!_tokenList.empty()
+      && (_ENDS_OPERAND >> _tokenList.back().getLabel()) & 1u)
+    {
       _product(Token::CONCAT);
     }
   }
 
-  void _tokenizeCurrent()
+  typedef SymbolRanges<SymbolT> _Ranges;
+
+  static SymbolT _sym(char c)
   {
-    static const std::map<SymbolT, typename Token::Label> table {
-      { Lexemes<SymbolT>::STAR, Token::STAR },
-      { Lexemes<SymbolT>::OR, Token::OR },
-      { Lexemes<SymbolT>::PLUS, Token::PLUS },
-      { Lexemes<SymbolT>::LEFT_PARENTH, Token::LEFT_PARENTH },
-      { Lexemes<SymbolT>::RIGHT_PARENTH, Token::RIGHT_PARENTH },
-      { Lexemes<SymbolT>::OPTION, Token::OPTION },
-    };
+    return static_cast<SymbolT>(c);
+  }
 
+  static bool _isAscii(SymbolT sym)
+  {
+    return static_cast<long>(sym) >= 0 && static_cast<long>(sym) < 128;
+  }
+
+  // the classes of \d, \w and \s, or an empty set for other letters
+  static _Ranges _namedClass(SymbolT letter)
+  {
+    _Ranges ranges;
+    if (!_isAscii(letter))
+    {
+      return ranges;
+    }
+    switch (static_cast<char>(letter))
+    {
+      case 'd':
+      case 'D':
+        ranges.add(_sym('0'), _sym('9'));
+        break;
+      case 'w':
+      case 'W':
+        ranges.add(_sym('a'), _sym('z'));
+        ranges.add(_sym('A'), _sym('Z'));
+        ranges.add(_sym('0'), _sym('9'));
+        ranges.add(_sym('_'));
+        break;
+      case 's':
+      case 'S':
+        ranges.add(_sym(' '));
+        ranges.add(_sym('\t'), _sym('\r'));
+        break;
+      default:
+        return ranges;
+    }
+    bool negated = letter == _sym('D') || letter == _sym('W') || letter == _sym('S');
+    return negated ? ranges.negated() : ranges;
+  }
+
+  static SymbolT _controlSymbol(SymbolT letter)
+  {
+    if (!_isAscii(letter))
+    {
+      return letter;
+    }
+    switch (static_cast<char>(letter))
+    {
+      case 'n': return _sym('\n');
+      case 't': return _sym('\t');
+      case 'r': return _sym('\r');
+      case 'f': return _sym('\f');
+      case 'v': return _sym('\v');
+      default:  return letter;
+    }
+  }
+
+  // reads the symbol following an escape, which is the current one
+  SymbolT _escaped()
+  {
+    SymbolT sym = _next();
+    if (sym == Lexemes<SymbolT>::END)
+    {
+      throw std::invalid_argument("nothing to escape");
+    }
+    return sym;
+  }
+
+  // [abc], [a-z0-9], [^"], with escapes and named classes inside; ']'
+  // first and '-' first or last stand for themselves.
+  _Ranges _readClass()
+  {
+    _Ranges ranges;
+    bool negated = _peek() == Lexemes<SymbolT>::NEGATION;
+    if (negated)
+    {
+      _next();
+    }
+
+    bool first = true;
+    for (SymbolT sym = _next(); first || sym != Lexemes<SymbolT>::RIGHT_BRACKET; sym = _next())
+    {
+      first = false;
+      if (sym == Lexemes<SymbolT>::END)
+      {
+        throw std::invalid_argument("missing right bracket");
+      }
+
+      SymbolT low = sym;
+      if (sym == Lexemes<SymbolT>::ESCAPE)
+      {
+        SymbolT letter = _escaped();
+        _Ranges named = _namedClass(letter);
+        if (!named.empty())
+        {
+          ranges.add(named);
+          continue;
+        }
+        low = _controlSymbol(letter);
+      }
+
+      SymbolT high = low;
+      if (_peek() == Lexemes<SymbolT>::RANGE && _peekAfterNext() != Lexemes<SymbolT>::RIGHT_BRACKET
+        && _peekAfterNext() != Lexemes<SymbolT>::END)
+      {
+        _next();
+        high = _next();
+        if (high == Lexemes<SymbolT>::ESCAPE)
+        {
+          SymbolT letter = _escaped();
+          if (!_namedClass(letter).empty())
+          {
+            throw std::invalid_argument("invalid range");
+          }
+          high = _controlSymbol(letter);
+        }
+        if (high < low)
+        {
+          throw std::invalid_argument("invalid range");
+        }
+      }
+      ranges.add(low, high);
+    }
+    return negated ? ranges.negated() : ranges;
+  }
+
+  void _productOperand(Token token)
+  {
+    _maybeAddConcat();
+    _product(token);
+  }
+
+  // the label of an operator symbol, END for any other symbol
+  static typename Token::Label _operatorOf(SymbolT sym)
+  {
+    switch (sym)
+    {
+      case Lexemes<SymbolT>::STAR:           return Token::STAR;
+      case Lexemes<SymbolT>::OR:             return Token::OR;
+      case Lexemes<SymbolT>::PLUS:           return Token::PLUS;
+      case Lexemes<SymbolT>::LEFT_PARENTH:   return Token::LEFT_PARENTH;
+      case Lexemes<SymbolT>::RIGHT_PARENTH:  return Token::RIGHT_PARENTH;
+      case Lexemes<SymbolT>::OPTION:         return Token::OPTION;
+      default:                               return Token::END;
+    }
+  }
+
+  void _tokenizeCurrent()
+  {
     SymbolT sym = _current();
+    typename Token::Label label = _operatorOf(sym);
 
-    if (sym == Lexemes<SymbolT>::LEFT_PARENTH)
+    if (label == Token::LEFT_PARENTH)
     {
       _maybeAddConcat();
     }
 
-    auto const& it = table.find(sym);
-    if (it != table.end())
+    if (label != Token::END)
+    {
+      _product(label);
+    }
+    else if (sym == Lexemes<SymbolT>::ANY)
+    {
+      _productOperand(Token(_Ranges::any()));
+    }
+    else if (sym == Lexemes<SymbolT>::LEFT_BRACKET)
+    {
+      _productOperand(Token(_readClass()));
+    }
+    else if (sym == Lexemes<SymbolT>::ESCAPE)
     {
-      _product(it->second);
+      SymbolT letter = _escaped();
+      _Ranges named = _namedClass(letter);
+      if (named.empty())
+      {
+        _productOperand(Token(Token::LAMBDA, _controlSymbol(letter)));
+      }
+      else
+      {
+        _productOperand(Token(named));
+      }
     }
     else
     {
-      _maybeAddConcat();
-      _product(Token::LAMBDA, sym);
+      _productOperand(Token(Token::LAMBDA, sym));
     }
   }
 
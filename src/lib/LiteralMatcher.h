@@ -0,0 +1,87 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef LITERAL_MATCHER_H
+#define LITERAL_MATCHER_H
+
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include "Span.h"
+
+// Engine for the patterns that are a plain string.
+template <typename SymbolT>
+class LiteralMatcher
+{
+private:
+  typedef std::char_traits<SymbolT> _Traits;
+
+  std::basic_string<SymbolT> _literal;
+
+public:
+  LiteralMatcher() = default;
+
+  explicit LiteralMatcher(std::basic_string<SymbolT> const& literal) :
+    _literal(literal)
+  {}
+
+  std::basic_string<SymbolT> const& getLiteral() const
+  {
+    return _literal;
+  }
+
+  bool match(SymbolT const* input) const
+  {
+    size_t length = _Traits::length(input);
+    return length == _literal.size()
+      && _Traits::compare(input, _literal.data(), length) == 0;
+  }
+
+  // position of the first occurrence in [begin, end), or nullptr
+  SymbolT const* find(SymbolT const* begin, SymbolT const* end) const
+  {
+    SymbolT const* it = std::search(begin, end, _literal.begin(), _literal.end());
+    return it == end && !_literal.empty() ? nullptr : it;
+  }
+
+  // the first occurrence in [begin, end), as a Span from 'begin'
+  bool search(SymbolT const* begin, SymbolT const* end, Span& span) const
+  {
+    SymbolT const* found = find(begin, end);
+    if (found == nullptr)
+    {
+      return false;
+    }
+    span.begin = found - begin;
+    span.end = span.begin + _literal.size();
+    return true;
+  }
+};
+
+template <>
+inline char const* LiteralMatcher<char>::find(char const* begin, char const* end) const
+{
+  return static_cast<char const*>(::memmem(begin, end - begin,
+    _literal.data(), _literal.size()));
+}
+
+#endif // LITERAL_MATCHER_H
@@ -0,0 +1,171 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef MATCHES_H
+#define MATCHES_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "AhoCorasick.h"
+#include "LiteralMatcher.h"
+#include "Searcher.h"
+#include "Span.h"
+
+// The non-overlapping leftmost-longest matches of a regex in an input, as
+// a range of Spans to iterate over once. Each match is searched from the end
+// of the previous one; after an empty match, the search moves on by one
+// symbol. The matches come from the Searcher, or from the literal engine the
+// planner chose. The input must outlive the range.
+template <typename SymbolT>
+class Matches
+{
+private:
+  Searcher<SymbolT> const* _searcher = nullptr;
+  LiteralMatcher<SymbolT> const* _literal = nullptr;
+  AhoCorasick<SymbolT> const* _strings = nullptr;
+  SymbolT const* _begin = nullptr;
+  SymbolT const* _end = nullptr;
+  std::vector<bool> _starts; // see Searcher::findStarts()
+
+public:
+  class Iterator
+  {
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef Span value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Span const* pointer;
+    typedef Span const& reference;
+
+  private:
+    Matches const* _matches;
+    Span _span;
+    bool _done;
+
+  public:
+    Iterator() :
+      _matches(nullptr), _done(true)
+    {}
+
+    Iterator(Matches const* matches, size_t from) :
+      _matches(matches), _done(false)
+    {
+      _find(from);
+    }
+
+    Span const& operator*() const
+    {
+      return _span;
+    }
+
+    Span const* operator->() const
+    {
+      return &_span;
+    }
+
+    Iterator& operator++()
+    {
+      _find(_span.length() == 0 ? _span.end + 1 : _span.end);
+      return *this;
+    }
+
+    Iterator operator++(int)
+    {
+      Iterator copy(*this);
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(Iterator const& other) const
+    {
+      return _done ? other._done : !other._done && _span == other._span;
+    }
+
+    bool operator!=(Iterator const& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    void _find(size_t from)
+    {
+      _done = !_matches->_searchFrom(from, _span);
+    }
+  };
+
+public:
+  // no match
+  Matches() = default;
+
+  Matches(Searcher<SymbolT> const& searcher, SymbolT const* begin,
+    SymbolT const* end) :
+    _searcher(&searcher), _begin(begin), _end(end)
+  {
+    _searcher->findStarts(_begin, _end, _starts);
+  }
+
+  Matches(LiteralMatcher<SymbolT> const& literal, SymbolT const* begin,
+    SymbolT const* end) :
+    _literal(&literal), _begin(begin), _end(end)
+  {}
+
+  Matches(AhoCorasick<SymbolT> const& strings, SymbolT const* begin,
+    SymbolT const* end) :
+    _strings(&strings), _begin(begin), _end(end)
+  {}
+
+  Iterator begin() const
+  {
+    return Iterator(this, 0);
+  }
+
+  Iterator end() const
+  {
+    return Iterator();
+  }
+
+private:
+  bool _searchFrom(size_t from, Span& span) const
+  {
+    if (_searcher != nullptr)
+    {
+      return _searcher->searchFrom(_begin, _end, _starts, from, span);
+    }
+    if (from > static_cast<size_t>(_end - _begin)
+      || (_literal == nullptr && _strings == nullptr))
+    {
+      return false;
+    }
+    bool found = _literal != nullptr
+      ? _literal->search(_begin + from, _end, span)
+      : _strings->search(_begin + from, _end, span);
+    if (found)
+    {
+      span.begin += from;
+      span.end += from;
+    }
+    return found;
+  }
+};
+
+#endif // MATCHES_H
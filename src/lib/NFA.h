@@ -26,25 +26,50 @@
 
 #include <set>
 #include <vector>
-#include <map>
 #include <stack>
 #include <utility>
 #include <initializer_list>
 #include <algorithm>
 #include <iostream>
 
+#include "Lexemes.h"
+#include "SymbolRanges.h"
+
 typedef unsigned int StateId;
 typedef std::set<StateId> StateSet;
 
 template <typename SymbolT>
 class NFA
 {
+public:
+  // a transition on every symbol of [low, high]
+  struct Transition
+  {
+    SymbolT low;
+    SymbolT high;
+    StateId target;
+
+    bool operator<(Transition const& other) const
+    {
+      return low != other.low ? low < other.low
+        : high != other.high ? high < other.high
+        : target < other.target;
+    }
+
+    bool operator==(Transition const& other) const
+    {
+      return low == other.low && high == other.high && target == other.target;
+    }
+  };
+
+  typedef std::vector<Transition> TransitionList;
+
 private:
   // private types
   // sub-types
-  typedef std::map<SymbolT, StateSet> _SymbolTransMap;
+  typedef TransitionList _SymbolTransList; // sorted
   typedef StateSet _EspilonTransSet;
-  typedef std::pair<_EspilonTransSet, _SymbolTransMap> _TransSetPair;
+  typedef std::pair<_EspilonTransSet, _SymbolTransList> _TransSetPair;
 
   // main type (vector of pair <set, map>)
   typedef std::vector<_TransSetPair> _TransitionTable; 
@@ -175,12 +200,31 @@ public:
   }
 
   void addTransition(StateId src, SymbolT symbol, StateId dst)
+  {
+    addTransition(src, symbol, symbol, dst);
+  }
+
+  void addTransition(StateId src, SymbolT low, SymbolT high, StateId dst)
   {
     assert(_exists(src)), assert(_exists(dst));
 
     if (_exists(src) && _exists(dst))
     {
-      (void) _transTable[src].second[symbol].emplace(dst);
+      auto& list = _transTable[src].second;
+      Transition transition { low, high, dst };
+      auto it = std::lower_bound(list.begin(), list.end(), transition);
+      if (it == list.end() || !(*it == transition))
+      {
+        list.insert(it, transition);
+      }
+    }
+  }
+
+  void addTransition(StateId src, SymbolRanges<SymbolT> const& ranges, StateId dst)
+  {
+    for (auto const& range : ranges.get())
+    {
+      addTransition(src, range.first, range.second, dst);
     }
   }
 
@@ -215,16 +259,10 @@ public:
         }
         pair.first = tmpSet;
 
-        // in symbol transitions
-        for (auto& innerPair : pair.second)
+        // in symbol transitions, which stay sorted
+        for (auto& transition : pair.second)
         {
-          // for each symbol
-          StateSet tmpSet;
-          for (auto& id : innerPair.second)
-          {
-            tmpSet.insert(id + _nextState);
-          }
-          innerPair.second = tmpSet;
+          transition.target += _nextState;
         }
       }
 
@@ -248,6 +286,48 @@ public:
     }
   }
 
+  // The automaton of the mirror language: every edge is reversed, a new
+  // initial state leads to the former acceptors and the former initial
+  // state is the only acceptor.
+  NFA reversed() const
+  {
+    NFA result;
+    while (result.size() < size())
+    {
+      result.addState();
+    }
+    for (StateId id = 0; id < _nextState; id++)
+    {
+      for (auto target : _transTable[id].first)
+      {
+        result.addEpsilonTransition(target, id);
+      }
+      for (auto const& transition : _transTable[id].second)
+      {
+        result.addTransition(transition.target, transition.low, transition.high, id);
+      }
+    }
+    StateId initial = result.addState();
+    for (auto acceptor : _acceptorSet)
+    {
+      result.addEpsilonTransition(initial, acceptor);
+    }
+    result.replaceInitial(initial);
+    result.setAcceptor(_initialState);
+    return result;
+  }
+
+  // The automaton of .*L: it can start reading at any position of the input.
+  NFA unanchored() const
+  {
+    NFA result(*this);
+    StateId initial = result.addState();
+    result.addTransition(initial, SymbolRanges<SymbolT>::any(), initial);
+    result.addEpsilonTransition(initial, _initialState);
+    result.replaceInitial(initial);
+    return result;
+  }
+
   // methods that search and return state's subset
   StateSet& epsilonClosure(StateId id) const
   {
@@ -290,26 +370,162 @@ public:
     return resultSet;
   }
 
-  StateSet const& transitions(StateId id, SymbolT symbol) const
+  // the states reached from 'id' on 'symbol'
+  StateSet transitions(StateId id, SymbolT symbol) const
   {
     assert (_exists(id));
 
-    if (!_exists(id))
+    StateSet result;
+    if (_exists(id))
     {
-      return _emptyConstSet;
+      for (auto const& transition : _transTable[id].second)
+      {
+        if (symbol < transition.low)
+        {
+          break;
+        }
+        if (symbol <= transition.high)
+        {
+          result.insert(transition.target);
+        }
+      }
     }
-    else
+    return result;
+  }
+
+  // the symbol transitions of 'id', sorted by their lowest symbol
+  TransitionList const& symbolTransitions(StateId id) const
+  {
+    assert(_exists(id));
+    return _transTable[id].second;
+  }
+
+  // calls f(target) for each transition of 'id' on 'symbol'
+  template <typename F>
+  void forEachTransition(StateId id, SymbolT symbol, F f) const
+  {
+    for (auto const& transition : _transTable[id].second)
     {
-      auto const& it = _transTable[id].second.find(symbol);
-      if (it == _transTable[id].second.end())
+      if (symbol < transition.low)
       {
-        return _emptyConstSet;
+        break;
       }
-      else
+      if (symbol <= transition.high)
+      {
+        f(transition.target);
+      }
+    }
+  }
+
+  // Extends 'states' with their epsilon closure, then sorts them. 'marks' is
+  // a scratch buffer, left marking exactly the states of the result.
+  void epsilonClosure(std::vector<StateId>& states, std::vector<bool>& marks) const
+  {
+    marks.assign(size(), false);
+    for (auto state : states)
+    {
+      marks[state] = true;
+    }
+    for (size_t i = 0; i < states.size(); i++)
+    {
+      for (auto reachable : _transTable[states[i]].first)
       {
-        return it->second;
+        if (!marks[reachable])
+        {
+          marks[reachable] = true;
+          states.push_back(reachable);
+        }
+      }
+    }
+    std::sort(states.begin(), states.end());
+  }
+
+  // The states from which every input is accepted, e.g. the one of a
+  // trailing .*: greatest set of the states whose epsilon closure holds an
+  // acceptor and moves into the set on every symbol.
+  std::vector<bool> universalStates() const
+  {
+    std::vector<std::vector<StateId>> epsilonPredecessors(size());
+    std::vector<StateId> stack;
+    std::vector<bool> universal(size(), false);
+    for (StateId id = 0; id < _nextState; id++)
+    {
+      for (auto target : _transTable[id].first)
+      {
+        epsilonPredecessors[target].push_back(id);
+      }
+    }
+    for (auto acceptor : _acceptorSet)
+    {
+      universal[acceptor] = true;
+      stack.push_back(acceptor);
+    }
+    while (!stack.empty())
+    {
+      StateId id = stack.back();
+      stack.pop_back();
+      for (auto predecessor : epsilonPredecessors[id])
+      {
+        if (!universal[predecessor])
+        {
+          universal[predecessor] = true;
+          stack.push_back(predecessor);
+        }
+      }
+    }
+
+    std::vector<StateId> closure;
+    std::vector<bool> marks;
+    for (bool changed = true; changed; )
+    {
+      changed = false;
+      for (StateId id = 0; id < _nextState; id++)
+      {
+        if (!universal[id])
+        {
+          continue;
+        }
+        closure.assign(1, id);
+        epsilonClosure(closure, marks);
+        SymbolRanges<SymbolT> covered(Lexemes<SymbolT>::END, Lexemes<SymbolT>::END);
+        for (auto state : closure)
+        {
+          for (auto const& transition : _transTable[state].second)
+          {
+            if (universal[transition.target])
+            {
+              covered.add(transition.low, transition.high);
+            }
+          }
+        }
+        if (!(covered == SymbolRanges<SymbolT>(SymbolRanges<SymbolT>::min(),
+          SymbolRanges<SymbolT>::max())))
+        {
+          universal[id] = false;
+          changed = true;
+        }
+      }
+    }
+    return universal;
+  }
+
+  // the first symbol of every class of symbols that no transition tells
+  // apart (see SymbolClasses)
+  std::set<SymbolT> classStarts() const
+  {
+    std::set<SymbolT> starts;
+    for (auto const& pair : _transTable)
+    {
+      for (auto const& transition : pair.second)
+      {
+        starts.insert(transition.low);
+        if (transition.high != SymbolRanges<SymbolT>::max())
+        {
+          starts.insert(static_cast<SymbolT>(transition.high + 1));
+        }
       }
     }
+    return starts;
   }
 
   StateSet const& epsilonTransitions(StateId id) const
@@ -353,10 +569,10 @@ public:
       std::cout << "epsilons:";
       _showSet(pair.first);
 
-      for (auto const& innerPair : pair.second)
+      for (auto const& transition : pair.second)
       {
-        std::cout << innerPair.first << ':';
-        _showSet(innerPair.second);
+        std::cout << transition.low << '-' << transition.high << ": "
+          << transition.target << std::endl;
       }
       id++;
     }
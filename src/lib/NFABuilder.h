@@ -23,7 +23,7 @@
 #define NFA_BUILDER_H
 
 #include <stack>
-#include <list>
+#include <vector>
 #include <stdexcept>
 #include <string>
 
@@ -31,29 +31,48 @@
 #include "Token.h"
 #include "Lexer.h"
 #include "NPIConvertor.h"
+#include "CompileOptions.h"
 
 template <typename SymbolT>
 class NFABuilder
 {
 private:
-  typedef Token<SymbolT> Token;
+  typedef ::Token<SymbolT> Token;
 
   NFA<SymbolT>& _nfa;
-  std::list<Token> _npi;
+  std::vector<Token> _npi;
   std::stack<NFA<SymbolT>*> _stack;
+  CompileBudget const* _budget;
 
 public:
-  NFABuilder(SymbolT const* expr, NFA<SymbolT>& nfa) :
-    _nfa(nfa)
+  NFABuilder(SymbolT const* expr, NFA<SymbolT>& nfa,
+    CompileBudget const* budget=nullptr) :
+    _nfa(nfa), _budget(budget)
   {
     try
     {
       _build(expr);
     }
-    catch (std::invalid_argument e)
+    catch (...)
     {
       _cleanUp();
-      throw e;
+      throw;
+    }
+  }
+
+  // builds from a postfix token list, as produced by NPIConvertor
+  NFABuilder(std::vector<Token> const& npi, NFA<SymbolT>& nfa,
+    CompileBudget const* budget=nullptr) :
+    _nfa(nfa), _npi(npi), _budget(budget)
+  {
+    try
+    {
+      _buildFromNPI();
+    }
+    catch (...)
+    {
+      _cleanUp();
+      throw;
     }
   }
 
@@ -76,6 +95,12 @@ public:
     return _nfa;
   }
 
+  // the pattern as a postfix token list
+  std::vector<Token> const& postfix() const
+  {
+    return _npi;
+  }
+
 private:
   NFA<SymbolT>& _safePop(std::string const& errMsg="syntax error")
   {
@@ -147,13 +172,34 @@ private:
     _stack.push(&res);
   }
 
+  // the star induction without the bypass, so that the operand is not copied
+  NFA<SymbolT>& _plusInduction(NFA<SymbolT>& operand) const
+  {
+    auto initial = operand.getInitial();
+    auto in = operand.addState();
+    auto out = operand.addState();
+
+    operand.addEpsilonTransition(in, initial);
+
+    assert(operand.getAcceptorSet().size() == 1);
+    for (auto state : operand.getAcceptorSet())
+    {
+      operand.addEpsilonTransition(state, initial);
+      operand.addEpsilonTransition(state, out);
+    }
+
+    operand.replaceInitial(in);
+    operand.clearAcceptorSet();
+    operand.setAcceptor(out);
+
+    return operand;
+  }
+
   void _treatPlus()
   {
     auto& operand = _safePop();
-    auto& clone = *new NFA<SymbolT>(operand);
-    auto& star = _starInduction(operand);
-    auto& res = _concatInduction(clone, star);
-    _stack.push(&res);
+    auto& result = _plusInduction(operand);
+    _stack.push(&result);
   }
 
   NFA<SymbolT>& _createAlwaysAcceptNFA() const
@@ -200,12 +246,26 @@ private:
     return result;
   }
 
-  void _treatLambda(Token token)
+  void _treatLambda(Token const& token)
   {
     _stack.push(&_createSimpleNFA(token.getValue()));
   }
 
-  void _shunt(Token token)
+  NFA<SymbolT>& _createClassNFA(SymbolRanges<SymbolT> const& ranges) const
+  {
+    auto& result = *new NFA<SymbolT>;
+    auto out = result.addState();
+    result.setAcceptor(out);
+    result.addTransition(result.getInitial(), ranges, out);
+    return result;
+  }
+
+  void _treatClass(Token const& token)
+  {
+    _stack.push(&_createClassNFA(token.getRanges()));
+  }
+
+  void _shunt(Token const& token)
   {
     switch (token.getLabel())
     {
@@ -215,6 +275,7 @@ private:
       case Token::OPTION:         _treatOption();       break;
       case Token::CONCAT:         _treatConcat();       break;
       case Token::LAMBDA:         _treatLambda(token);  break;
+      case Token::CLASS:          _treatClass(token);   break;
       default:
         assert (false); // unreachable, it's a bug otherwise
         throw std::invalid_argument("It's not a bug, it's a feature ... :s");
@@ -223,7 +284,7 @@ private:
 
   void _buildNPI(SymbolT const* expr)
   {
-    std::list<Token> tokens;
+    std::vector<Token> tokens;
     Lexer<SymbolT> lexer(expr, tokens);
     NPIConvertor<SymbolT> convertor(tokens, _npi);
   }
@@ -250,13 +311,28 @@ private:
   void _build(SymbolT const* expr)
   {
     _buildNPI(expr);
+    _buildFromNPI();
+  }
 
-    for (auto token : _npi)
+  void _buildFromNPI()
+  {
+    for (auto const& token : _npi)
     {
       _shunt(token);
+      _checkBudget(_stack.top()->size());
     }
 
     _buildResult();
+    _checkBudget(_nfa.size());
+  }
+
+  void _checkBudget(size_t states) const
+  {
+    if (_budget != nullptr)
+    {
+      _budget->checkNFAStates(states);
+      _budget->checkTime();
+    }
   }
 
   void _cleanUp()
@@ -27,8 +27,9 @@
 
 #include "NFA.h"
 #include "Lexemes.h"
+#include "RegexStats.h"
 
-template <typename SymbolT>
+template <typename SymbolT, typename CountersT=NullCounters>
 class NFASimulator
 {
 private:
@@ -38,16 +39,34 @@ private:
   std::stack<StateId> _newStates;
 
   NFA<SymbolT> const* _nfa = nullptr;
+  CountersT* _counters;
+
+  // see NFA::universalStates(); once one is active, the input is accepted
+  std::vector<bool> const* _universal;
+  bool _universalReached = false;
 
 public:
-  NFASimulator() = default;
+  explicit NFASimulator(CountersT* counters=nullptr,
+    std::vector<bool> const* universal=nullptr) :
+    _counters(counters), _universal(universal)
+  {}
+
   ~NFASimulator() = default;
 
   bool simulate(NFA<SymbolT> const& nfa, SymbolT const* input)
+  {
+    return simulate(nfa, { nfa.getInitial() }, input);
+  }
+
+  // Resumes a simulation from an arbitrary set of states. It stops as soon
+  // as no state is active, or a universal one is.
+  bool simulate(NFA<SymbolT> const& nfa, StateSet const& from,
+    SymbolT const* input)
   {
     _cleanUp();
-    _init(nfa);
-    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END; i++)
+    _init(nfa, from);
+    for (size_t i = 0; input[i] != Lexemes<SymbolT>::END
+      && !_oldStates.empty() && !_universalReached; i++)
     {
       SymbolT current = input[i];
       _expand(current);
@@ -59,6 +78,7 @@ private:
   void _cleanUp()
   {
     _nfa = nullptr;
+    _universalReached = false;
     _alreadyIn.clear();
     while (!_oldStates.empty())
     {
@@ -70,15 +90,16 @@ private:
     }
   }
 
-  void _init(NFA<SymbolT> const& nfa)
+  void _init(NFA<SymbolT> const& nfa, StateSet const& from)
   {
     _nfa = &nfa;
     _alreadyIn.reserve(nfa.size());
     _alreadyIn.insert(_alreadyIn.end(), nfa.size(), false);
-    StateSet& epsSet = nfa.epsilonClosure(nfa.getInitial());
+    StateSet& epsSet = nfa.epsilonClosure(from);
     for (auto state : epsSet)
     {
       _oldStates.push(state);
+      _checkUniversal(state);
     }
     delete &epsSet;
   }
@@ -98,11 +119,26 @@ private:
     _alreadyIn[state] = false;
   }
 
+  void _checkUniversal(StateId state)
+  {
+    if (_universal != nullptr && (*_universal)[state])
+    {
+      _universalReached = true;
+    }
+  }
+
   void _addState(StateId state)
   {
     _newStates.push(state);
     _setIn(state);
-    for (auto reachable : _nfa->epsilonTransitions(state))
+    _checkUniversal(state);
+    auto const& epsilons = _nfa->epsilonTransitions(state);
+    if (CountersT::ENABLED && _counters != nullptr)
+    {
+      _counters->onNFAStates(1);
+      _counters->onClosure(epsilons.size());
+    }
+    for (auto reachable : epsilons)
     {
       if (!_isAlreadyIn(reachable))
       {
@@ -115,13 +151,12 @@ private:
   {
     while (!_oldStates.empty())
     {
-      for (auto state : _nfa->transitions(_oldStates.top(), symbol))
-      {
+      _nfa->forEachTransition(_oldStates.top(), symbol, [this] (StateId state) {
         if (!_isAlreadyIn(state))
         {
           _addState(state);
         }
-      }
+      });
       _oldStates.pop();
     }
 
@@ -23,9 +23,8 @@
 #define NPI_CONVERTOR_H
 
 #include <stack>
-#include <list>
 #include <vector>
-#include <set>
+#include <stdexcept>
 
 #include "Token.h"
 
@@ -33,59 +32,55 @@ template <typename SymbolT>
 class NPIConvertor
 {
 private:
-  typedef Token<SymbolT> Token;
+  typedef ::Token<SymbolT> Token;
 
   enum Fixity { LEFT, RIGHT, BOTH };
 
 public:
-  NPIConvertor(std::list<Token> const& input, std::list<Token>& output) :
-    _input(input), _output(output)
+  // With 'groups', each parenthesized operand is followed by a GROUP token,
+  // the groups being numbered from 1 in the order of their left parenthesis.
+  NPIConvertor(std::vector<Token> const& input, std::vector<Token>& output,
+    bool groups=false) :
+    _input(input), _output(output), _groups(groups)
   {
     _convert();
   }
 
-  NPIConvertor(std::list<Token> const& input) :
-    NPIConvertor(input, *new std::list<Token>)
+  NPIConvertor(std::vector<Token> const& input) :
+    NPIConvertor(input, *new std::vector<Token>)
   {}
 
-  std::list<Token>& collect()
+  std::vector<Token>& collect()
   {
     return _output;
   }
 
-  std::list<Token> const& collect() const
+  std::vector<Token> const& collect() const
   {
     return _output;
   }
 
 private:
-  std::list<Token> const& _input;
-  std::list<Token>& _output;
-  std::stack<Token> _stack;
+  std::vector<Token> const& _input;
+  std::vector<Token>& _output;
+  std::stack<Token, std::vector<Token>> _stack;
+  bool _groups;
+  unsigned _groupCount = 0;
+  std::stack<unsigned, std::vector<unsigned>> _openGroups;
 
 private:
+  // higher binds tighter
   static int _getPrecedence(typename Token::Label o)
   {
-    // first = lower precedence, last = higher precedence
-    static const std::vector<std::set<typename Token::Label>> table {
-      { Token::CONCAT },
-      { Token::OR },
-      { Token::STAR, Token::PLUS, Token::OPTION }
-    };
-
-    size_t res = 0;
-    for (auto const& set : table)
+    switch (o)
     {
-      if (set.count(o) == 1)
-      {
-        return res;
-      }
-      else
-      {
-        res++;
-      }
+      case Token::CONCAT:   return 0;
+      case Token::OR:       return 1;
+      case Token::STAR:
+      case Token::PLUS:
+      case Token::OPTION:   return 2;
+      default:              throw std::invalid_argument("unkown operator");
     }
-    throw std::invalid_argument("unkown operator");
   }
 
   static int _comparePrecedence(typename Token::Label o1, typename Token::Label o2)
@@ -95,27 +90,14 @@ private:
 
   static Fixity _getFixity(typename Token::Label o)
   {
-    static std::set<typename Token::Label> rightSet {
-      Token::CONCAT, Token::OR, Token::STAR, Token::PLUS, Token::OPTION
-    };
-    static std::set<typename Token::Label> leftSet {
-      Token::CONCAT, Token::OR, Token::STAR, Token::PLUS, Token::OPTION
-    };
-
-    bool r = rightSet.count(o) == 1;
-    bool l = leftSet.count(o) == 1;
- 
-    if (r && l)
+    switch (o)
     {
-      return BOTH;
-    }
-    else if (r)
-    {
-      return RIGHT;
-    }
-    else // if (l)
-    {
-      return LEFT;
+      case Token::CONCAT:
+      case Token::OR:
+      case Token::STAR:
+      case Token::PLUS:
+      case Token::OPTION:   return BOTH;
+      default:              return LEFT;
     }
   }
 
@@ -134,9 +116,14 @@ private:
     {
       _stack.pop();
     }
+    if (_groups)
+    {
+      _output.push_back(Token::group(_openGroups.top()));
+      _openGroups.pop();
+    }
   }
 
-  void _treatOperator(Token op)
+  void _treatOperator(Token const& op)
   {
     Fixity fixity = _getFixity(op.getLabel());
     bool stop = false;
@@ -166,16 +153,18 @@ private:
     _stack.push(op);
   }
 
-  void _shunt(Token token)
+  void _shunt(Token const& token)
   {
     switch (token.getLabel())
     {
       case Token::LAMBDA:
+      case Token::CLASS:
         _output.push_back(token);
         break;
 
       case Token::LEFT_PARENTH:
         _stack.push(token);
+        _openGroups.push(++_groupCount);
         break;
 
       case Token::RIGHT_PARENTH:
@@ -208,7 +197,7 @@ private:
 
   void _convert()
   {
-    for (auto token : _input)
+    for (auto const& token : _input)
     {
       if (token.getLabel() == Token::END)
       {
@@ -0,0 +1,254 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef ONE_PASS_DFA_H
+#define ONE_PASS_DFA_H
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "PikeVM.h"
+#include "SymbolClasses.h"
+#include "Span.h"
+
+// Extracts the capture groups at DFA speed when the pattern is one-pass:
+// from any point of a match, the next symbol tells which instruction of the
+// PikeVM program reads it, and by which path of SPLIT and SAVE instructions.
+// Then a single thread runs, so each state of the DFA is the instruction
+// reached, and each transition carries the capture slots to set on the way,
+// as a bit mask. The captures are those of the PikeVM. Patterns which are not
+// one-pass, or have more than 31 groups, are left to the PikeVM.
+template <typename SymbolT>
+class OnePassDFA
+{
+private:
+  typedef PikeVM<SymbolT> _VM;
+  typedef typename _VM::Instruction _Instruction;
+  typedef uint64_t _Slots;
+
+  static const unsigned _DEAD = std::numeric_limits<unsigned>::max();
+  static const size_t _MAX_SLOTS = 64;
+
+  struct _Transition
+  {
+    unsigned next = _DEAD;
+    _Slots saves = 0;
+  };
+
+  struct _State
+  {
+    bool accepting = false;
+    _Slots matchSaves = 0;
+  };
+
+  bool _onePass = false;
+  unsigned _groupCount = 0;
+  SymbolClasses<SymbolT> _classes;
+  std::vector<_State> _states;
+  std::vector<_Transition> _transitions; // state * classes + class
+
+public:
+  OnePassDFA() = default;
+
+  explicit OnePassDFA(_VM const& vm) :
+    _groupCount(vm.groupCount())
+  {
+    _onePass = 2 * (_groupCount + 1) <= _MAX_SLOTS && _build(vm);
+    if (!_onePass)
+    {
+      _states.clear();
+      _transitions.clear();
+    }
+  }
+
+  bool isOnePass() const
+  {
+    return _onePass;
+  }
+
+  size_t stateCount() const
+  {
+    return _states.size();
+  }
+
+  // same contract as PikeVM::match()
+  bool match(SymbolT const* input, Span const& span, std::vector<Span>& groups) const
+  {
+    size_t slots[_MAX_SLOTS];
+    size_t slotCount = 2 * (_groupCount + 1);
+    std::fill(slots, slots + slotCount, static_cast<size_t>(-1));
+
+    unsigned state = 0;
+    for (size_t position = span.begin; position < span.end; position++)
+    {
+      _Transition const& transition =
+        _transitions[state * _classes.size() + _classes.classOf(input[position])];
+      if (transition.next == _DEAD)
+      {
+        return false;
+      }
+      _save(slots, slotCount, transition.saves, position);
+      state = transition.next;
+    }
+    if (!_states[state].accepting)
+    {
+      return false;
+    }
+    _save(slots, slotCount, _states[state].matchSaves, span.end);
+
+    groups.assign(_groupCount + 1, Span::unset());
+    groups[0] = span;
+    for (unsigned i = 1; i <= _groupCount; i++)
+    {
+      if (slots[2 * i] != static_cast<size_t>(-1)
+        && slots[2 * i + 1] != static_cast<size_t>(-1))
+      {
+        groups[i].begin = slots[2 * i];
+        groups[i].end = slots[2 * i + 1];
+      }
+    }
+    return true;
+  }
+
+private:
+  static void _save(size_t* slots, size_t slotCount, _Slots saves, size_t position)
+  {
+    for (size_t i = 0; saves != 0 && i < slotCount; i++, saves >>= 1)
+    {
+      if (saves & 1)
+      {
+        slots[i] = position;
+      }
+    }
+  }
+
+  // Returns false as soon as the program turns out not to be one-pass. The
+  // state i is entered at the instruction _entries[i].
+  bool _build(_VM const& vm)
+  {
+    auto const& program = vm.getProgram();
+
+    std::set<SymbolT> starts;
+    for (auto const& instruction : program)
+    {
+      if (instruction.op == _VM::SYMBOL)
+      {
+        SymbolClasses<SymbolT>::split(starts, instruction.symbol, instruction.symbol);
+      }
+      else if (instruction.op == _VM::CLASS)
+      {
+        SymbolClasses<SymbolT>::split(starts, instruction.ranges);
+      }
+    }
+    _classes = SymbolClasses<SymbolT>(starts);
+
+    std::vector<unsigned> entries { vm.getStart() };
+    std::map<unsigned, unsigned> stateOf { { vm.getStart(), 0 } };
+    for (unsigned id = 0; id < entries.size(); id++)
+    {
+      _states.emplace_back();
+      _transitions.resize(_states.size() * _classes.size());
+
+      // the instructions the entry reaches without reading
+      std::map<unsigned, _Slots> reached;
+      std::vector<std::pair<unsigned, _Slots>> stack { { entries[id], 0 } };
+      while (!stack.empty())
+      {
+        unsigned pc = stack.back().first;
+        _Slots saves = stack.back().second;
+        stack.pop_back();
+
+        auto it = reached.find(pc);
+        if (it != reached.end())
+        {
+          if (it->second != saves)
+          {
+            return false; // two paths which capture differently
+          }
+          continue;
+        }
+        reached.emplace(pc, saves);
+
+        _Instruction const& instruction = program[pc];
+        switch (instruction.op)
+        {
+          case _VM::SPLIT:
+            stack.emplace_back(instruction.next, saves);
+            stack.emplace_back(instruction.alternative, saves);
+            break;
+
+          case _VM::SAVE:
+            stack.emplace_back(instruction.next, saves | (_Slots(1) << instruction.slot));
+            break;
+
+          case _VM::MATCH:
+            _states[id].accepting = true;
+            _states[id].matchSaves = saves;
+            break;
+
+          default:
+          {
+            auto found = stateOf.find(instruction.next);
+            unsigned next;
+            if (found == stateOf.end())
+            {
+              next = static_cast<unsigned>(entries.size());
+              entries.push_back(instruction.next);
+              stateOf.emplace(instruction.next, next);
+            }
+            else
+            {
+              next = found->second;
+            }
+
+            for (size_t cls = 0; cls < _classes.size(); cls++)
+            {
+              if (!instruction.reads(_classes.representative(cls)))
+              {
+                continue;
+              }
+              _Transition& transition = _transitions[id * _classes.size() + cls];
+              if (transition.next != _DEAD)
+              {
+                return false; // two instructions read the same symbol
+              }
+              transition.next = next;
+              transition.saves = saves;
+            }
+            break;
+          }
+        }
+      }
+    }
+    return true;
+  }
+};
+
+template <typename SymbolT>
+const unsigned OnePassDFA<SymbolT>::_DEAD;
+
+template <typename SymbolT>
+const size_t OnePassDFA<SymbolT>::_MAX_SLOTS;
+
+#endif // ONE_PASS_DFA_H
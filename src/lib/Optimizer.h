@@ -0,0 +1,485 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <memory>
+#include <stack>
+#include <stdexcept>
+#include <vector>
+
+#include "Token.h"
+#include "SymbolRanges.h"
+
+// Rewrites a postfix token list (as produced by NPIConvertor) into a smaller
+// one of the same language, before NFABuilder turns it into an automaton:
+//  - nested repetitions collapse: a** -> a*, (a?)* -> a*, (a+)? -> a*, ...
+//  - the single-symbol alternatives of an alternation merge into one class:
+//    a|b|[c-e] -> [a-e];
+//  - the common prefixes and suffixes of alternatives are factored out, as
+//    in a trie: abc|abd|x -> ab[cd]|x and ab|b -> a?b.
+template <typename SymbolT>
+class Optimizer
+{
+private:
+  typedef ::Token<SymbolT> Token;
+
+  struct _Node;
+  typedef std::shared_ptr<_Node> _NodePtr;
+
+  // CONCAT and OR nodes are n-ary; END stands for the empty string, which
+  // only appears while factoring.
+  struct _Node
+  {
+    Token token;
+    std::vector<_NodePtr> children;
+
+    explicit _Node(Token const& t, std::vector<_NodePtr> const& c={}) :
+      token(t), children(c)
+    {}
+
+    typename Token::Label label() const
+    {
+      return token.getLabel();
+    }
+  };
+
+  std::vector<Token> const& _input;
+  std::vector<Token>& _output;
+
+public:
+  Optimizer(std::vector<Token> const& input, std::vector<Token>& output) :
+    _input(input), _output(output)
+  {
+    _optimize();
+  }
+
+  std::vector<Token>& collect()
+  {
+    return _output;
+  }
+
+  std::vector<Token> const& collect() const
+  {
+    return _output;
+  }
+
+private:
+  void _optimize()
+  {
+    std::stack<_NodePtr> stack;
+    for (auto const& token : _input)
+    {
+      switch (token.getLabel())
+      {
+        case Token::LAMBDA:
+        case Token::CLASS:
+          stack.push(_leaf(token));
+          break;
+
+        case Token::STAR:
+        case Token::PLUS:
+        case Token::OPTION:
+          stack.push(std::make_shared<_Node>(token,
+            std::vector<_NodePtr> { _pop(stack) }));
+          break;
+
+        case Token::CONCAT:
+        case Token::OR:
+        {
+          _NodePtr right = _pop(stack);
+          _NodePtr left = _pop(stack);
+          stack.push(_append(token, left, right));
+          break;
+        }
+
+        default:
+          throw std::invalid_argument("syntax error");
+      }
+    }
+
+    if (stack.size() > 1)
+    {
+      throw std::invalid_argument("missing operator(s)");
+    }
+    if (!stack.empty())
+    {
+      _serialize(_simplify(stack.top()));
+    }
+  }
+
+  // a chain of the same binary operator makes one n-ary node
+  static _NodePtr _append(Token const& token, _NodePtr left, _NodePtr const& right)
+  {
+    if (left->label() != token.getLabel())
+    {
+      left = std::make_shared<_Node>(token, std::vector<_NodePtr> { left });
+    }
+    if (right->label() == token.getLabel())
+    {
+      left->children.insert(left->children.end(), right->children.begin(),
+        right->children.end());
+    }
+    else
+    {
+      left->children.push_back(right);
+    }
+    return left;
+  }
+
+  // rewrites the tree bottom-up
+  static _NodePtr _simplify(_NodePtr const& node)
+  {
+    std::vector<_NodePtr> children;
+    for (auto const& child : node->children)
+    {
+      children.push_back(_simplify(child));
+    }
+
+    switch (node->label())
+    {
+      case Token::CONCAT:   return _concat(children);
+      case Token::OR:       return _or(children);
+      case Token::STAR:
+      case Token::PLUS:
+      case Token::OPTION:   return _repeat(node->label(), children.front());
+      default:              return node;
+    }
+  }
+
+  static _NodePtr _pop(std::stack<_NodePtr>& stack)
+  {
+    if (stack.empty())
+    {
+      throw std::invalid_argument("syntax error");
+    }
+    _NodePtr node = stack.top();
+    stack.pop();
+    return node;
+  }
+
+  static _NodePtr _leaf(Token const& token)
+  {
+    if (token.getLabel() == Token::CLASS && token.getRanges().count() == 1)
+    {
+      return _leaf(Token(Token::LAMBDA, token.getRanges().get().front().first));
+    }
+    return std::make_shared<_Node>(token);
+  }
+
+  static _NodePtr _empty()
+  {
+    return std::make_shared<_Node>(Token(Token::END));
+  }
+
+  // a repetition of 'operand', whose own repetition is absorbed
+  static _NodePtr _repeat(typename Token::Label label, _NodePtr operand)
+  {
+    if (operand->label() == Token::END)
+    {
+      return operand;
+    }
+    auto inner = operand->label();
+    if (inner == Token::STAR || inner == Token::PLUS || inner == Token::OPTION)
+    {
+      if (inner == label)
+      {
+        return operand;
+      }
+      // any other mix of two repetitions is a star
+      return _repeat(Token::STAR, operand->children.front());
+    }
+    return std::make_shared<_Node>(Token(label), std::vector<_NodePtr> { operand });
+  }
+
+  static _NodePtr _concat(std::vector<_NodePtr> const& factors)
+  {
+    std::vector<_NodePtr> flat;
+    for (auto const& factor : factors)
+    {
+      if (factor->label() == Token::CONCAT)
+      {
+        flat.insert(flat.end(), factor->children.begin(), factor->children.end());
+      }
+      else if (factor->label() != Token::END)
+      {
+        flat.push_back(factor);
+      }
+    }
+    if (flat.empty())
+    {
+      return _empty();
+    }
+    if (flat.size() == 1)
+    {
+      return flat.front();
+    }
+    return std::make_shared<_Node>(Token(Token::CONCAT), flat);
+  }
+
+  static _NodePtr _or(std::vector<_NodePtr> const& alternatives)
+  {
+    std::vector<_NodePtr> flat;
+    for (auto const& alternative : alternatives)
+    {
+      if (alternative->label() == Token::OR)
+      {
+        flat.insert(flat.end(), alternative->children.begin(),
+          alternative->children.end());
+      }
+      else
+      {
+        flat.push_back(alternative);
+      }
+    }
+
+    flat = _mergeSymbols(flat);
+    flat = _unique(flat);
+    flat = _factor(flat, true);
+    flat = _factor(flat, false);
+
+    // the empty alternative makes the others optional
+    bool nullable = false;
+    std::vector<_NodePtr> rest;
+    for (auto const& alternative : flat)
+    {
+      if (alternative->label() == Token::END)
+      {
+        nullable = true;
+      }
+      else
+      {
+        rest.push_back(alternative);
+      }
+    }
+
+    _NodePtr result;
+    if (rest.empty())
+    {
+      result = _empty();
+    }
+    else if (rest.size() == 1)
+    {
+      result = rest.front();
+    }
+    else
+    {
+      result = std::make_shared<_Node>(Token(Token::OR), rest);
+    }
+    return nullable ? _repeat(Token::OPTION, result) : result;
+  }
+
+  // the symbols and classes of an alternation make one class, in place of
+  // the first of them
+  static std::vector<_NodePtr> _mergeSymbols(std::vector<_NodePtr> const& alternatives)
+  {
+    SymbolRanges<SymbolT> ranges;
+    size_t count = 0;
+    for (auto const& alternative : alternatives)
+    {
+      if (_isSymbolSet(alternative))
+      {
+        ranges.add(_rangesOf(alternative));
+        count++;
+      }
+    }
+    if (count < 2)
+    {
+      return alternatives;
+    }
+
+    std::vector<_NodePtr> result;
+    bool merged = false;
+    for (auto const& alternative : alternatives)
+    {
+      if (!_isSymbolSet(alternative))
+      {
+        result.push_back(alternative);
+      }
+      else if (!merged)
+      {
+        result.push_back(_leaf(Token(ranges)));
+        merged = true;
+      }
+    }
+    return result;
+  }
+
+  static std::vector<_NodePtr> _unique(std::vector<_NodePtr> const& alternatives)
+  {
+    std::vector<_NodePtr> result;
+    for (auto const& alternative : alternatives)
+    {
+      bool found = false;
+      for (auto const& kept : result)
+      {
+        found = found || _equal(kept, alternative);
+      }
+      if (!found)
+      {
+        result.push_back(alternative);
+      }
+    }
+    return result;
+  }
+
+  // Groups the alternatives by their first (or last) factor: a group of
+  // several becomes the factor concatenated with the alternation of what
+  // remains of each of them.
+  static std::vector<_NodePtr> _factor(std::vector<_NodePtr> const& alternatives,
+    bool prefix)
+  {
+    std::vector<_NodePtr> result;
+    std::vector<bool> done(alternatives.size(), false);
+    for (size_t i = 0; i < alternatives.size(); i++)
+    {
+      if (done[i])
+      {
+        continue;
+      }
+      _NodePtr factor = _edgeFactor(alternatives[i], prefix);
+      std::vector<_NodePtr> remainders;
+      for (size_t j = i; j < alternatives.size() && factor; j++)
+      {
+        _NodePtr other = done[j] ? nullptr : _edgeFactor(alternatives[j], prefix);
+        if (other && _equal(factor, other))
+        {
+          remainders.push_back(_remainder(alternatives[j], prefix));
+          done[j] = true;
+        }
+      }
+
+      if (remainders.size() < 2)
+      {
+        result.push_back(alternatives[i]);
+        done[i] = true;
+      }
+      else
+      {
+        _NodePtr rest = _or(remainders);
+        result.push_back(prefix ? _concat({ factor, rest }) : _concat({ rest, factor }));
+      }
+    }
+    return result;
+  }
+
+  static _NodePtr _edgeFactor(_NodePtr const& node, bool first)
+  {
+    if (node->label() == Token::END)
+    {
+      return nullptr;
+    }
+    if (node->label() != Token::CONCAT)
+    {
+      return node;
+    }
+    return first ? node->children.front() : node->children.back();
+  }
+
+  static _NodePtr _remainder(_NodePtr const& node, bool first)
+  {
+    if (node->label() != Token::CONCAT)
+    {
+      return _empty();
+    }
+    auto const& children = node->children;
+    return first ? _concat(std::vector<_NodePtr>(children.begin() + 1, children.end()))
+      : _concat(std::vector<_NodePtr>(children.begin(), children.end() - 1));
+  }
+
+  static bool _isSymbolSet(_NodePtr const& node)
+  {
+    return node->label() == Token::LAMBDA || node->label() == Token::CLASS;
+  }
+
+  static SymbolRanges<SymbolT> _rangesOf(_NodePtr const& node)
+  {
+    if (node->label() == Token::CLASS)
+    {
+      return node->token.getRanges();
+    }
+    return SymbolRanges<SymbolT>(node->token.getValue(), node->token.getValue());
+  }
+
+  static bool _equal(_NodePtr const& left, _NodePtr const& right)
+  {
+    if (left == right)
+    {
+      return true;
+    }
+    if (left->label() != right->label()
+      || left->children.size() != right->children.size())
+    {
+      return false;
+    }
+    if (left->label() == Token::LAMBDA
+      && left->token.getValue() != right->token.getValue())
+    {
+      return false;
+    }
+    if (left->label() == Token::CLASS
+      && !(left->token.getRanges() == right->token.getRanges()))
+    {
+      return false;
+    }
+    for (size_t i = 0; i < left->children.size(); i++)
+    {
+      if (!_equal(left->children[i], right->children[i]))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void _serialize(_NodePtr const& node)
+  {
+    switch (node->label())
+    {
+      case Token::CONCAT:
+      case Token::OR:
+        _serialize(node->children.front());
+        for (size_t i = 1; i < node->children.size(); i++)
+        {
+          _serialize(node->children[i]);
+          _output.push_back(node->token);
+        }
+        break;
+
+      case Token::STAR:
+      case Token::PLUS:
+      case Token::OPTION:
+        _serialize(node->children.front());
+        _output.push_back(node->token);
+        break;
+
+      case Token::END: // the whole pattern is empty
+        break;
+
+      default:
+        _output.push_back(node->token);
+        break;
+    }
+  }
+};
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,94 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef PARSE_PATTERN_H
+#define PARSE_PATTERN_H
+
+#include <stdexcept>
+#include <vector>
+
+#include "CompileOptions.h"
+#include "Lexer.h"
+#include "NPIConvertor.h"
+#include "Optimizer.h"
+#include "PikeVM.h"
+#include "Token.h"
+#include "Utf8Convertor.h"
+
+// The UTF-8 patterns are parsed into byte automata, for char symbols only.
+inline std::vector<Token<char>> utf8Postfix(char const* expr, bool groups)
+{
+  return Utf8Convertor::postfix(expr, groups);
+}
+
+template <typename SymbolT>
+std::vector<Token<SymbolT>> utf8Postfix(SymbolT const*, bool)
+{
+  throw std::invalid_argument("UTF-8 patterns need char symbols");
+}
+
+// The front end shared by the compilers: the Lexer, the NPIConvertor and
+// the Optimizer (or the Utf8Convertor, with options.utf8) turn a pattern
+// into the postfix token list the automata are built from. If 'captures'
+// is given and the pattern has groups, it is set to the PikeVM of the
+// groups.
+template <typename SymbolT>
+std::vector<Token<SymbolT>> parsePattern(SymbolT const* expr,
+  CompileOptions const& options, PikeVM<SymbolT>* captures=nullptr)
+{
+  bool groups = captures != nullptr;
+  std::vector<Token<SymbolT>> grouped;
+  if (options.utf8)
+  {
+    grouped = utf8Postfix(expr, groups);
+  }
+  else
+  {
+    std::vector<Token<SymbolT>> tokens;
+    Lexer<SymbolT> lexer(expr, tokens);
+    NPIConvertor<SymbolT> convertor(tokens, grouped, groups);
+  }
+
+  std::vector<Token<SymbolT>> npi;
+  npi.reserve(grouped.size());
+  for (auto const& token : grouped)
+  {
+    if (token.getLabel() != Token<SymbolT>::GROUP)
+    {
+      npi.push_back(token);
+    }
+  }
+  if (captures != nullptr && npi.size() != grouped.size())
+  {
+    *captures = PikeVM<SymbolT>(grouped);
+  }
+
+  if (!options.optimize)
+  {
+    return npi;
+  }
+  std::vector<Token<SymbolT>> optimized;
+  Optimizer<SymbolT> optimizer(npi, optimized);
+  return optimized;
+}
+
+#endif // PARSE_PATTERN_H
@@ -0,0 +1,379 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PIKE_VM_H
+#define PIKE_VM_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Token.h"
+#include "SymbolRanges.h"
+#include "Span.h"
+
+// Finds the capture groups of a match with a Pike VM. The postfix pattern,
+// GROUP tokens included, is compiled into a program; its threads then run in
+// lock step over the input, at most one per instruction, each with the same
+// fixed number of capture slots. So the cost is O(input x program) whatever
+// the pattern, without backtracking. When there are several ways to match,
+// the threads are ranked like in Perl: left alternatives first and greedy
+// repetitions.
+template <typename SymbolT>
+class PikeVM
+{
+public:
+  enum Op { SYMBOL, CLASS, SPLIT, SAVE, MATCH };
+
+  // Group i is saved to the slots 2i (start) and 2i + 1 (end).
+  struct Instruction
+  {
+    Op op;
+    SymbolT symbol;                // SYMBOL
+    SymbolRanges<SymbolT> ranges;  // CLASS
+    unsigned next;
+    unsigned alternative;          // SPLIT, lower priority than next
+    unsigned slot;                 // SAVE
+
+    // whether the instruction reads the symbol (SYMBOL and CLASS only)
+    bool reads(SymbolT input) const
+    {
+      return (op == SYMBOL && symbol == input) || (op == CLASS && ranges.contains(input));
+    }
+  };
+
+private:
+  typedef ::Token<SymbolT> Token;
+
+  static const size_t _UNSET = static_cast<size_t>(-1);
+
+  // A piece of program under construction: its entry and its exits still to
+  // be linked, as instruction * 2 (+ 1 for the alternative).
+  struct _Fragment
+  {
+    unsigned start;
+    std::vector<unsigned> exits;
+  };
+
+  // the threads of one step, in priority order, with their slots
+  struct _Threads
+  {
+    std::vector<unsigned> pcs;
+    std::vector<unsigned> index; // sparse set over the instructions
+    std::vector<size_t> slots;   // slotCount per instruction
+
+    _Threads(size_t instructions, size_t slotCount) :
+      index(instructions), slots(instructions * slotCount)
+    {
+      pcs.reserve(instructions);
+    }
+
+    bool contains(unsigned pc) const
+    {
+      return index[pc] < pcs.size() && pcs[index[pc]] == pc;
+    }
+
+    void add(unsigned pc)
+    {
+      index[pc] = static_cast<unsigned>(pcs.size());
+      pcs.push_back(pc);
+    }
+  };
+
+  // pending work of _addThread(): follow 'pc', or give 'slot' back 'value'
+  struct _Frame
+  {
+    bool restore;
+    unsigned pc;
+    unsigned slot;
+    size_t value;
+  };
+
+  std::vector<Instruction> _program;
+  unsigned _start = 0;
+  unsigned _groupCount = 0;
+
+public:
+  PikeVM() = default;
+
+  explicit PikeVM(std::vector<Token> const& postfix)
+  {
+    _compile(postfix);
+  }
+
+  std::vector<Instruction> const& getProgram() const
+  {
+    return _program;
+  }
+
+  unsigned getStart() const
+  {
+    return _start;
+  }
+
+  // capture groups, the whole match aside
+  unsigned groupCount() const
+  {
+    return _groupCount;
+  }
+
+  // Matches exactly the symbols 'span' of 'input', and sets groups[0] to the
+  // span and groups[i] to the group i (Span::unset() if it took no part in
+  // the match). Returns false if the span does not match.
+  bool match(SymbolT const* input, Span const& span, std::vector<Span>& groups) const
+  {
+    size_t slotCount = 2 * (_groupCount + 1);
+    _Threads current(_program.size(), slotCount);
+    _Threads next(_program.size(), slotCount);
+    std::vector<size_t> slots(slotCount, _UNSET);
+    std::vector<_Frame> stack;
+
+    bool found = false;
+    _addThread(current, _start, slots.data(), slotCount, span.begin, stack);
+    for (size_t position = span.begin; !current.pcs.empty(); position++)
+    {
+      for (auto pc : current.pcs)
+      {
+        Instruction const& instruction = _program[pc];
+        size_t* threadSlots = current.slots.data() + pc * slotCount;
+        if (instruction.op == MATCH && position == span.end)
+        {
+          slots.assign(threadSlots, threadSlots + slotCount);
+          found = true;
+          break; // the lower priority threads are dropped
+        }
+        if (position < span.end && instruction.reads(input[position]))
+        {
+          _addThread(next, instruction.next, threadSlots, slotCount,
+            position + 1, stack);
+        }
+      }
+      if (found || position == span.end)
+      {
+        break;
+      }
+      std::swap(current, next);
+      next.pcs.clear();
+    }
+    if (!found)
+    {
+      return false;
+    }
+
+    groups.assign(_groupCount + 1, Span::unset());
+    groups[0] = span;
+    for (unsigned i = 1; i <= _groupCount; i++)
+    {
+      if (slots[2 * i] != _UNSET && slots[2 * i + 1] != _UNSET)
+      {
+        groups[i].begin = slots[2 * i];
+        groups[i].end = slots[2 * i + 1];
+      }
+    }
+    return true;
+  }
+
+private:
+  // Adds the thread at 'pc' and the ones it reaches without reading, in
+  // priority order, each with the slots it has at 'position'.
+  void _addThread(_Threads& threads, unsigned pc, size_t* slots,
+    size_t slotCount, size_t position, std::vector<_Frame>& stack) const
+  {
+    stack.push_back(_Frame { false, pc, 0, 0 });
+    while (!stack.empty())
+    {
+      _Frame frame = stack.back();
+      stack.pop_back();
+      if (frame.restore)
+      {
+        slots[frame.slot] = frame.value;
+        continue;
+      }
+      if (threads.contains(frame.pc))
+      {
+        continue;
+      }
+      threads.add(frame.pc);
+
+      Instruction const& instruction = _program[frame.pc];
+      switch (instruction.op)
+      {
+        case SPLIT:
+          stack.push_back(_Frame { false, instruction.alternative, 0, 0 });
+          stack.push_back(_Frame { false, instruction.next, 0, 0 });
+          break;
+
+        case SAVE:
+          stack.push_back(_Frame { true, 0, instruction.slot, slots[instruction.slot] });
+          slots[instruction.slot] = position;
+          stack.push_back(_Frame { false, instruction.next, 0, 0 });
+          break;
+
+        default:
+          std::copy(slots, slots + slotCount,
+            threads.slots.begin() + frame.pc * slotCount);
+          break;
+      }
+    }
+  }
+
+  unsigned _emit(Op op, unsigned next=0, unsigned alternative=0)
+  {
+    Instruction instruction;
+    instruction.op = op;
+    instruction.symbol = SymbolT();
+    instruction.next = next;
+    instruction.alternative = alternative;
+    instruction.slot = 0;
+    _program.push_back(instruction);
+    return static_cast<unsigned>(_program.size() - 1);
+  }
+
+  void _link(std::vector<unsigned> const& exits, unsigned target)
+  {
+    for (auto exit : exits)
+    {
+      Instruction& instruction = _program[exit / 2];
+      (exit % 2 == 0 ? instruction.next : instruction.alternative) = target;
+    }
+  }
+
+  _Fragment _pop(std::vector<_Fragment>& stack)
+  {
+    if (stack.empty())
+    {
+      throw std::invalid_argument("syntax error");
+    }
+    _Fragment fragment = std::move(stack.back());
+    stack.pop_back();
+    return fragment;
+  }
+
+  void _compile(std::vector<Token> const& postfix)
+  {
+    std::vector<_Fragment> stack;
+    for (auto const& token : postfix)
+    {
+      switch (token.getLabel())
+      {
+        case Token::LAMBDA:
+        {
+          unsigned pc = _emit(SYMBOL);
+          _program[pc].symbol = token.getValue();
+          stack.push_back(_Fragment { pc, { 2 * pc } });
+          break;
+        }
+
+        case Token::CLASS:
+        {
+          unsigned pc = _emit(CLASS);
+          _program[pc].ranges = token.getRanges();
+          stack.push_back(_Fragment { pc, { 2 * pc } });
+          break;
+        }
+
+        case Token::CONCAT:
+        {
+          _Fragment second = _pop(stack);
+          _Fragment first = _pop(stack);
+          _link(first.exits, second.start);
+          stack.push_back(_Fragment { first.start, std::move(second.exits) });
+          break;
+        }
+
+        case Token::OR:
+        {
+          _Fragment second = _pop(stack);
+          _Fragment first = _pop(stack);
+          unsigned pc = _emit(SPLIT, first.start, second.start);
+          first.exits.insert(first.exits.end(), second.exits.begin(),
+            second.exits.end());
+          stack.push_back(_Fragment { pc, std::move(first.exits) });
+          break;
+        }
+
+        case Token::STAR:
+        {
+          _Fragment operand = _pop(stack);
+          unsigned pc = _emit(SPLIT, operand.start);
+          _link(operand.exits, pc);
+          stack.push_back(_Fragment { pc, { 2 * pc + 1 } });
+          break;
+        }
+
+        case Token::PLUS:
+        {
+          _Fragment operand = _pop(stack);
+          unsigned pc = _emit(SPLIT, operand.start);
+          _link(operand.exits, pc);
+          stack.push_back(_Fragment { operand.start, { 2 * pc + 1 } });
+          break;
+        }
+
+        case Token::OPTION:
+        {
+          _Fragment operand = _pop(stack);
+          unsigned pc = _emit(SPLIT, operand.start);
+          operand.exits.push_back(2 * pc + 1);
+          stack.push_back(_Fragment { pc, std::move(operand.exits) });
+          break;
+        }
+
+        case Token::GROUP:
+        {
+          _Fragment operand = _pop(stack);
+          unsigned open = _emit(SAVE, operand.start);
+          unsigned close = _emit(SAVE);
+          _program[open].slot = 2 * token.getGroup();
+          _program[close].slot = 2 * token.getGroup() + 1;
+          _link(operand.exits, close);
+          _groupCount = std::max(_groupCount, token.getGroup());
+          stack.push_back(_Fragment { open, { 2 * close } });
+          break;
+        }
+
+        default:
+          throw std::invalid_argument("unexpected token in the postfix pattern");
+      }
+    }
+    if (stack.size() > 1)
+    {
+      throw std::invalid_argument("syntax error");
+    }
+
+    unsigned match = _emit(MATCH);
+    if (stack.empty())
+    {
+      _start = match;
+    }
+    else
+    {
+      _link(stack.back().exits, match);
+      _start = stack.back().start;
+    }
+  }
+};
+
+template <typename SymbolT>
+const size_t PikeVM<SymbolT>::_UNSET;
+
+#endif // PIKE_VM_H
@@ -0,0 +1,353 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <set>
+#include <stack>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+#include "Token.h"
+#include "CompileOptions.h"
+#include "GlushkovBuilder.h"
+
+// Chooses the engine of a pattern from its postfix token list:
+//  - a single string goes to the LiteralMatcher,
+//  - a finite set of strings goes to AhoCorasick,
+//  - a small position automaton goes to BitParallel,
+//  - anything else goes to the DFA, determinized up front when it is small
+//    enough, lazily otherwise.
+// Along the way, it finds a string that every match must contain, if any,
+// which the other engines use as a prefilter.
+template <typename SymbolT>
+class Planner
+{
+public:
+  typedef std::basic_string<SymbolT> String;
+
+  // above that, a finite language is not worth enumerating
+  static const size_t MAX_LITERALS = 256;
+
+  // above that, a class is not worth expanding into strings
+  static const size_t MAX_CLASS_SIZE = 16;
+
+private:
+  typedef ::Token<SymbolT> Token;
+
+  // what is known of the language of a sub-pattern
+  struct _Fragment
+  {
+    bool finite;
+    std::set<String> strings; // meaningful if finite
+    String prefix;            // every string starts with it
+    String suffix;            // every string ends with it
+    String required;          // every string contains it
+  };
+
+  CompileOptions const& _options;
+  CompileOptions::Engine _engine;
+  std::string _reason;
+  std::vector<String> _literals;
+  String _required;
+  std::stack<_Fragment> _stack;
+
+public:
+  Planner(std::vector<Token> const& npi, CompileOptions const& options) :
+    _options(options)
+  {
+    _analyze(npi);
+    _choose(npi);
+  }
+
+  CompileOptions::Engine getEngine() const
+  {
+    return _engine;
+  }
+
+  std::string const& getReason() const
+  {
+    return _reason;
+  }
+
+  // the strings of the language, for LITERAL and AHO_CORASICK
+  std::vector<String> const& getLiterals() const
+  {
+    return _literals;
+  }
+
+  // a string that every match contains, maybe empty
+  String const& getRequired() const
+  {
+    return _required;
+  }
+
+private:
+  static _Fragment _infinite(String const& prefix=String(),
+    String const& suffix=String(), String const& required=String())
+  {
+    return _Fragment { false, std::set<String>(), prefix, suffix, required };
+  }
+
+  static _Fragment _finite(std::set<String> const& strings)
+  {
+    _Fragment fragment { true, strings, *strings.begin(), *strings.begin(), String() };
+    for (auto const& str : strings)
+    {
+      fragment.prefix = _commonPrefix(fragment.prefix, str);
+      fragment.suffix = _commonSuffix(fragment.suffix, str);
+    }
+    fragment.required = _longest(fragment.prefix, fragment.suffix);
+    return fragment;
+  }
+
+  static String _commonPrefix(String const& a, String const& b)
+  {
+    size_t i = 0;
+    while (i < a.size() && i < b.size() && a[i] == b[i])
+    {
+      i++;
+    }
+    return a.substr(0, i);
+  }
+
+  static String _commonSuffix(String const& a, String const& b)
+  {
+    size_t i = 0;
+    while (i < a.size() && i < b.size() && a[a.size() - 1 - i] == b[b.size() - 1 - i])
+    {
+      i++;
+    }
+    return a.substr(a.size() - i);
+  }
+
+  static String const& _longest(String const& a, String const& b)
+  {
+    return a.size() >= b.size() ? a : b;
+  }
+
+  static bool _isSingle(_Fragment const& fragment)
+  {
+    return fragment.finite && fragment.strings.size() == 1;
+  }
+
+  static _Fragment _class(SymbolRanges<SymbolT> const& ranges)
+  {
+    if (ranges.empty() || ranges.count() > MAX_CLASS_SIZE)
+    {
+      return _infinite();
+    }
+    std::set<String> strings;
+    for (auto const& range : ranges.get())
+    {
+      for (SymbolT sym = range.first; ; sym++)
+      {
+        strings.insert(String(1, sym));
+        if (sym == range.second)
+        {
+          break;
+        }
+      }
+    }
+    return _finite(strings);
+  }
+
+  _Fragment _pop()
+  {
+    if (_stack.empty())
+    {
+      throw std::invalid_argument("syntax error");
+    }
+    _Fragment fragment = _stack.top();
+    _stack.pop();
+    return fragment;
+  }
+
+  _Fragment _concat(_Fragment const& left, _Fragment const& right) const
+  {
+    if (left.finite && right.finite
+      && left.strings.size() * right.strings.size() <= MAX_LITERALS)
+    {
+      std::set<String> product;
+      for (auto const& l : left.strings)
+      {
+        for (auto const& r : right.strings)
+        {
+          product.insert(l + r);
+        }
+      }
+      return _finite(product);
+    }
+
+    // the suffix of the left side and the prefix of the right side are
+    // contiguous in every match
+    String junction = left.suffix + right.prefix;
+    return _infinite(
+      _isSingle(left) ? left.prefix + right.prefix : left.prefix,
+      _isSingle(right) ? left.suffix + right.suffix : right.suffix,
+      _longest(junction, _longest(left.required, right.required)));
+  }
+
+  _Fragment _or(_Fragment const& left, _Fragment const& right) const
+  {
+    if (left.finite && right.finite
+      && left.strings.size() + right.strings.size() <= MAX_LITERALS)
+    {
+      std::set<String> strings(left.strings);
+      strings.insert(right.strings.begin(), right.strings.end());
+      return _finite(strings);
+    }
+    String prefix = _commonPrefix(left.prefix, right.prefix);
+    String suffix = _commonSuffix(left.suffix, right.suffix);
+    return _infinite(prefix, suffix, _longest(prefix, suffix));
+  }
+
+  void _shunt(Token const& token)
+  {
+    switch (token.getLabel())
+    {
+      case Token::LAMBDA:
+        _stack.push(_finite({ String(1, token.getValue()) }));
+        break;
+
+      case Token::CLASS:
+        _stack.push(_class(token.getRanges()));
+        break;
+
+      case Token::CONCAT:
+      case Token::OR:
+      {
+        _Fragment right = _pop();
+        _Fragment left = _pop();
+        _stack.push(token.getLabel() == Token::CONCAT
+          ? _concat(left, right) : _or(left, right));
+        break;
+      }
+
+      case Token::OPTION:
+        _stack.push(_or(_pop(), _finite({ String() })));
+        break;
+
+      case Token::PLUS:
+      {
+        _Fragment operand = _pop();
+        _stack.push(_infinite(operand.prefix, operand.suffix, operand.required));
+        break;
+      }
+
+      case Token::STAR:
+        _pop();
+        _stack.push(_infinite());
+        break;
+
+      default:
+        throw std::invalid_argument("unexpected token");
+    }
+  }
+
+  void _analyze(std::vector<Token> const& npi)
+  {
+    for (auto const& token : npi)
+    {
+      _shunt(token);
+    }
+
+    _Fragment root = _finite({ String() });
+    if (_stack.size() == 1)
+    {
+      root = _pop();
+    }
+    else if (!_stack.empty())
+    {
+      throw std::invalid_argument("missing operator(s)");
+    }
+
+    if (root.finite)
+    {
+      _literals.assign(root.strings.begin(), root.strings.end());
+    }
+    _required = root.required;
+  }
+
+  bool _isFeasible(CompileOptions::Engine engine, size_t positions) const
+  {
+    switch (engine)
+    {
+      case CompileOptions::LITERAL:       return _literals.size() == 1;
+      case CompileOptions::AHO_CORASICK:  return !_literals.empty();
+      case CompileOptions::BIT_PARALLEL:
+        return positions <= PositionAutomaton<SymbolT>::MAX_SIZE;
+      default:                            return true;
+    }
+  }
+
+  void _choose(std::vector<Token> const& npi)
+  {
+    size_t positions = GlushkovBuilder<SymbolT>::countPositions(npi);
+    std::ostringstream reason;
+
+    if (_options.engine != CompileOptions::AUTO)
+    {
+      if (!_isFeasible(_options.engine, positions))
+      {
+        throw std::invalid_argument(std::string("the pattern cannot run on ")
+          + CompileOptions::toString(_options.engine));
+      }
+      _engine = _options.engine;
+      reason << "forced by the compile options";
+    }
+    else if (_literals.size() == 1)
+    {
+      _engine = CompileOptions::LITERAL;
+      reason << "the pattern is a plain string";
+    }
+    else if (!_literals.empty())
+    {
+      _engine = CompileOptions::AHO_CORASICK;
+      reason << "the pattern is an alternation of " << _literals.size()
+        << " strings";
+    }
+    else if (positions <= PositionAutomaton<SymbolT>::MAX_SIZE)
+    {
+      _engine = CompileOptions::BIT_PARALLEL;
+      reason << "the position automaton has " << positions
+        << " states, it fits in a machine word";
+    }
+    else if (_options.maxDFAStates != 0)
+    {
+      _engine = CompileOptions::EAGER_DFA;
+      reason << "the position automaton has " << positions
+        << " states, too many for a machine word";
+    }
+    else
+    {
+      _engine = CompileOptions::LAZY_DFA;
+      reason << "the position automaton has " << positions
+        << " states and up-front determinization is disabled";
+    }
+    _reason = reason.str();
+  }
+};
+
+#endif // PLANNER_H
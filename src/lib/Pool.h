@@ -0,0 +1,136 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+// A thread-safe stack of reusable scratch objects (e.g. lazy DFA caches).
+// The lock is only taken to pop or push an object, never while it is used,
+// so concurrent callers each work on their own instance.
+template <typename T>
+class Pool
+{
+private:
+  std::mutex _mutex;
+  std::vector<std::unique_ptr<T>> _free;
+  std::function<T*()> _factory;
+  unsigned _generation = 0;
+
+public:
+  class Guard
+  {
+  private:
+    Pool& _pool;
+    std::unique_ptr<T> _value;
+    unsigned _generation;
+
+  public:
+    Guard(Pool& pool, std::unique_ptr<T> value, unsigned generation) :
+      _pool(pool), _value(std::move(value)), _generation(generation)
+    {}
+
+    Guard(Guard&& other) :
+      _pool(other._pool), _value(std::move(other._value)),
+      _generation(other._generation)
+    {}
+
+    Guard(Guard const&) = delete;
+    void operator=(Guard const&) = delete;
+
+    ~Guard()
+    {
+      if (_value)
+      {
+        _pool._put(std::move(_value), _generation);
+      }
+    }
+
+    T& operator*() const
+    {
+      return *_value;
+    }
+
+    T* operator->() const
+    {
+      return _value.get();
+    }
+  };
+
+public:
+  explicit Pool(std::function<T*()> factory) :
+    _factory(factory)
+  {}
+
+  Pool(Pool const&) = delete;
+  void operator=(Pool const&) = delete;
+
+  Guard get()
+  {
+    std::unique_ptr<T> value;
+    std::function<T*()> factory;
+    unsigned generation;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      generation = _generation;
+      if (!_free.empty())
+      {
+        value = std::move(_free.back());
+        _free.pop_back();
+      }
+      else
+      {
+        factory = _factory;
+      }
+    }
+    if (!value)
+    {
+      value.reset(factory());
+    }
+    return Guard(*this, std::move(value), generation);
+  }
+
+  // replaces the factory and drops every idle object; the ones currently in
+  // use are dropped when they are given back.
+  void reset(std::function<T*()> factory)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _factory = factory;
+    _generation++;
+    _free.clear();
+  }
+
+private:
+  void _put(std::unique_ptr<T> value, unsigned generation)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation == _generation)
+    {
+      _free.push_back(std::move(value));
+    }
+  }
+};
+
+#endif // POOL_H
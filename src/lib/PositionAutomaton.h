@@ -0,0 +1,100 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef POSITION_AUTOMATON_H
+#define POSITION_AUTOMATON_H
+
+#include <cassert>
+#include <cstdint>
+
+#include <vector>
+
+#include "SymbolRanges.h"
+
+// The position (Glushkov) automaton of a pattern: one state per symbol
+// occurrence in the pattern, plus the initial state 0. Every transition
+// entering a position is labelled by the symbol of that position, so the
+// automaton is fully described by the follow set of each position. The
+// symbol of a position may be a class of symbols. Sets of
+// positions are bit masks, which bounds the automaton to 64 states.
+template <typename SymbolT>
+class PositionAutomaton
+{
+public:
+  typedef uint64_t Mask;
+
+  static const size_t MAX_SIZE = 64;
+
+private:
+  std::vector<SymbolRanges<SymbolT>> _symbols; // _symbols[0] is meaningless
+  std::vector<Mask> _follow;
+  Mask _final = 0;
+
+public:
+  PositionAutomaton() :
+    _symbols(1), _follow(1, 0)
+  {}
+
+  size_t size() const
+  {
+    return _symbols.size();
+  }
+
+  size_t addPosition(SymbolRanges<SymbolT> const& symbol)
+  {
+    assert(size() < MAX_SIZE);
+    _symbols.push_back(symbol);
+    _follow.push_back(0);
+    return size() - 1;
+  }
+
+  SymbolRanges<SymbolT> const& symbolOf(size_t position) const
+  {
+    return _symbols[position];
+  }
+
+  Mask getFollow(size_t position) const
+  {
+    return _follow[position];
+  }
+
+  void addFollow(size_t position, Mask positions)
+  {
+    _follow[position] |= positions;
+  }
+
+  Mask getFinalMask() const
+  {
+    return _final;
+  }
+
+  void setFinalMask(Mask positions)
+  {
+    _final = positions;
+  }
+
+  static Mask bit(size_t position)
+  {
+    return Mask(1) << position;
+  }
+};
+
+#endif // POSITION_AUTOMATON_H
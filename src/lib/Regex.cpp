@@ -22,52 +22,9 @@
 #include "Regex.h"
 #include "Lexemes.h"
 
-template<>
-template<>
-char const* Regex::arrayOfCustom(std::string const& str)
-{
-  return str.c_str();
-}
-
-template<>
-char const Lexemes<char>::STAR = '*';
-template<>
-char const Lexemes<char>::OR = '|';
-template<>
-char const Lexemes<char>::PLUS = '+';
-template<>
-char const Lexemes<char>::OPTION = '?';
-template<>
-char const Lexemes<char>::LEFT_PARENTH = '(';
-template<>
-char const Lexemes<char>::RIGHT_PARENTH = ')';
-template<>
-char const Lexemes<char>::END = '\0';
-
 template<>
 std::string Lexemes<char>::toString(char sym)
 {
   return std::string(1, sym);
 }
 
-template<>
-template<>
-wchar_t const* WRegex::arrayOfCustom(std::wstring const& str)
-{
-  return str.c_str();
-}
-
-template<>
-wchar_t const Lexemes<wchar_t>::STAR = '*';
-template<>
-wchar_t const Lexemes<wchar_t>::OR = '|';
-template<>
-wchar_t const Lexemes<wchar_t>::PLUS = '+';
-template<>
-wchar_t const Lexemes<wchar_t>::OPTION = '?';
-template<>
-wchar_t const Lexemes<wchar_t>::LEFT_PARENTH = '(';
-template<>
-wchar_t const Lexemes<wchar_t>::RIGHT_PARENTH = ')';
-template<>
-wchar_t const Lexemes<wchar_t>::END = '\0';
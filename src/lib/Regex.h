@@ -25,8 +25,19 @@
 #include <string>
 
 #include "RegexBase.h"
+#include "CompileAll.h"
+#include "HotSwap.h"
+#include "TokenizerBase.h"
 
 typedef RegexBase<char> Regex;
 typedef RegexBase<wchar_t> WRegex;
 
+// same, counting what every match costs (see RegexStats.h)
+typedef RegexBase<char, AtomicCounters> InstrumentedRegex;
+typedef RegexBase<wchar_t, AtomicCounters> InstrumentedWRegex;
+
+// many token patterns scanned at once (see TokenizerBase.h)
+typedef TokenizerBase<char> Tokenizer;
+typedef TokenizerBase<wchar_t> WTokenizer;
+
 #endif // REGEX_H
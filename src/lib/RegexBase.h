@@ -22,33 +22,200 @@
 #ifndef REGEX_BASE_H
 #define REGEX_BASE_H
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+
 #include "NFA.h"
 #include "NFABuilder.h"
 #include "NFASimulator.h"
+#include "DFA.h"
+#include "DFABuilder.h"
+#include "SharedLazyDFA.h"
+#include "Pool.h"
+#include "CompileOptions.h"
+#include "Planner.h"
+#include "LiteralMatcher.h"
+#include "AhoCorasick.h"
+#include "PositionAutomaton.h"
+#include "GlushkovBuilder.h"
+#include "BitParallel.h"
+#include "RegexStats.h"
+#include "ParsePattern.h"
+#include "Searcher.h"
+#include "Span.h"
+#include "Matches.h"
+#include "PikeVM.h"
+#include "OnePassDFA.h"
+#include "TaggedDFA.h"
+#include "BoundedBacktracker.h"
+#include "BatchDFA.h"
+#include "ApproximateMatcher.h"
 
-template <typename SymbolT>
+// CountersT is NullCounters or AtomicCounters (see RegexStats.h); the former
+// compiles the instrumentation out.
+template <typename SymbolT, typename CountersT=NullCounters>
 class RegexBase
 {
 private:
-  NFA<SymbolT> _nfa;
+  typedef CompileOptions::Engine _Engine;
 
-public:
-  RegexBase(SymbolT const* expr)
+  // The compiled pattern, immutable once built and shared by every copy of
+  // the regex. The parts that only some calls need are built on their first
+  // use, once for all the copies.
+  struct _Program
   {
-    NFABuilder<SymbolT> builder(expr, _nfa);
-  }
+    std::basic_string<SymbolT> pattern;
+    CompileOptions options;
+    NFA<SymbolT> nfa;
+
+    // chosen by the Planner
+    _Engine engine;
+    std::string reason;
+
+    // engines, only the chosen one is filled
+    LiteralMatcher<SymbolT> literal;
+    AhoCorasick<SymbolT> ahoCorasick;
+    BitParallel<SymbolT> bitParallel;
+    DFA<SymbolT> dfa;
+
+    // a string every match contains, checked before running the engine
+    LiteralMatcher<SymbolT> prefilter;
+    bool hasPrefilter = false;
+
+    // see NFA::universalStates(), for LAZY_DFA
+    std::vector<bool> universal;
+
+    // extract the capture groups, if any: the one-pass DFA if the pattern
+    // allows it, else the tagged DFA within maxDFAStates, else a backtracker
+    // for the short matches and the PikeVM for the others. The DFAs are
+    // built on the first capture.
+    PikeVM<SymbolT> captures;
+    mutable std::once_flag captureDFAsBuilt;
+    mutable OnePassDFA<SymbolT> onePass;
+    mutable TaggedDFA<SymbolT> tagged;
+    mutable Pool<BoundedBacktracker<SymbolT>> backtrackers;
+
+    // built on the first search
+    mutable std::once_flag searcherBuilt;
+    mutable std::unique_ptr<Searcher<SymbolT>> searcher;
+
+    // built on the first batch
+    mutable std::once_flag batchBuilt;
+    mutable std::unique_ptr<BatchDFA<SymbolT>> batch;
+
+    // built on the first approximate match, null if the position automaton
+    // does not fit in a machine word
+    mutable std::once_flag approximateBuilt;
+    mutable std::unique_ptr<ApproximateMatcher<SymbolT>> approximate;
+
+    _Program(SymbolT const* expr, CompileOptions const& compileOptions) :
+      pattern(expr),
+      options(compileOptions),
+      backtrackers(_backtrackerFactory)
+    {
+      _compile(expr, *this);
+    }
+
+    // the compiled parts only
+    _Program(_Program const& other) :
+      pattern(other.pattern),
+      options(other.options),
+      nfa(other.nfa),
+      engine(other.engine),
+      reason(other.reason),
+      literal(other.literal),
+      ahoCorasick(other.ahoCorasick),
+      bitParallel(other.bitParallel),
+      dfa(other.dfa),
+      prefilter(other.prefilter),
+      hasPrefilter(other.hasPrefilter),
+      universal(other.universal),
+      captures(other.captures),
+      backtrackers(_backtrackerFactory)
+    {}
+  };
+
+  // the options of this copy, whose cache budget may differ
+  CompileOptions _options;
+  std::shared_ptr<_Program const> _program;
+
+  // For LAZY_DFA, one cache warmed by every thread and shared by the copies,
+  // until one of them changes its budget. It refers to the program, so it is
+  // destroyed first.
+  std::shared_ptr<LazyDFACache<SymbolT>> _cache;
+  mutable LazyDFAStats _cacheStats;
+
+  static const size_t _BATCH_BLOCK = 64;
+
+  mutable CountersT _counters;
+
+public:
+  RegexBase(SymbolT const* expr, CompileOptions const& options=CompileOptions()) :
+    _options(options),
+    _program(std::make_shared<_Program>(expr, options)),
+    _cache(_makeCache())
+  {}
+
+  // Copies share the compiled program and the lazy DFA cache, so a copy
+  // costs a reference count; they have their own counters.
+  RegexBase(RegexBase const& other) :
+    _options(other._options),
+    _program(other._program),
+    _cache(other._cache)
+  {}
 
   template <typename T>
-  RegexBase(T const& customExpr) :
-    RegexBase(arrayOfCustom(customExpr))
+  RegexBase(T const& customExpr, CompileOptions const& options=CompileOptions()) :
+    RegexBase(arrayOfCustom(customExpr), options)
   {}
 
   ~RegexBase() = default;
 
+  RegexBase& operator=(RegexBase const& other)
+  {
+    if (this != &other)
+    {
+      _cache.reset();
+      _options = other._options;
+      _program = other._program;
+      _cache = other._cache;
+    }
+    return *this;
+  }
+
   bool match(SymbolT const* input) const
   {
-    NFASimulator<SymbolT> simulator;
-    return simulator.simulate(_nfa, input);
+    if (CountersT::ENABLED)
+    {
+      _counters.onCall(std::char_traits<SymbolT>::length(input) * sizeof(SymbolT));
+    }
+
+    bool prefiltered = false;
+    if (_program->hasPrefilter)
+    {
+      prefiltered = _passPrefilter(input);
+      if (CountersT::ENABLED)
+      {
+        _counters.onPrefilter(prefiltered);
+      }
+      if (!prefiltered)
+      {
+        return false;
+      }
+    }
+
+    bool result = _run(input);
+    if (CountersT::ENABLED && result)
+    {
+      _counters.onMatch();
+      if (prefiltered)
+      {
+        _counters.onConfirm();
+      }
+    }
+    return result;
   }
 
   template <typename T>
@@ -56,7 +223,596 @@ public:
     return match(arrayOfCustom(customInput));
   }
 
+  // Matches a batch of inputs: results[i] = match(inputs[i]). If the regex
+  // determinizes within maxDFAStates, the inputs run through its DFA several
+  // at a time (see BatchDFA), which suits the many short inputs.
+  void matchBatch(SymbolT const* const* inputs, size_t count, bool* results) const
+  {
+    BatchDFA<SymbolT> const* batch = _getBatchDFA();
+    if (batch == nullptr)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        results[i] = match(inputs[i]);
+      }
+      return;
+    }
+    size_t lengths[_BATCH_BLOCK];
+    for (size_t first = 0; first < count; first += _BATCH_BLOCK)
+    {
+      size_t size = std::min(_BATCH_BLOCK, count - first);
+      for (size_t i = 0; i < size; i++)
+      {
+        lengths[i] = std::char_traits<SymbolT>::length(inputs[first + i]);
+      }
+      batch->accepts(inputs + first, lengths, size, results + first);
+      _countBatch(lengths, size, results + first);
+    }
+  }
+
+  // the same for strings, which are matched whole
+  void matchBatch(std::vector<std::basic_string<SymbolT>> const& inputs,
+    std::vector<bool>& results) const
+  {
+    BatchDFA<SymbolT> const* batch = _getBatchDFA();
+    results.resize(inputs.size());
+    SymbolT const* pointers[_BATCH_BLOCK];
+    size_t lengths[_BATCH_BLOCK];
+    bool blockResults[_BATCH_BLOCK];
+    for (size_t first = 0; first < inputs.size(); first += _BATCH_BLOCK)
+    {
+      size_t size = std::min(_BATCH_BLOCK, inputs.size() - first);
+      for (size_t i = 0; i < size; i++)
+      {
+        pointers[i] = inputs[first + i].c_str();
+        lengths[i] = inputs[first + i].size();
+      }
+      if (batch != nullptr)
+      {
+        batch->accepts(pointers, lengths, size, blockResults);
+        _countBatch(lengths, size, blockResults);
+      }
+      else
+      {
+        for (size_t i = 0; i < size; i++)
+        {
+          blockResults[i] = match(pointers[i]);
+        }
+      }
+      std::copy(blockResults, blockResults + size, results.begin() + first);
+    }
+  }
+
+  // Finds the leftmost-longest substring of the input that matches; 'span'
+  // is only set on success.
+  bool search(SymbolT const* input, Span& span) const
+  {
+    size_t length = std::char_traits<SymbolT>::length(input);
+    if (CountersT::ENABLED)
+    {
+      _counters.onCall(length * sizeof(SymbolT));
+    }
+    if (_program->hasPrefilter && !_passPrefilter(input))
+    {
+      return false;
+    }
+
+    bool result;
+    switch (_program->engine)
+    {
+      case CompileOptions::LITERAL:
+        result = _program->literal.search(input, input + length, span);
+        break;
+      case CompileOptions::AHO_CORASICK:
+        result = _program->ahoCorasick.search(input, input + length, span);
+        break;
+      default:
+        result = _getSearcher().search(input, input + length, span);
+        break;
+    }
+    if (CountersT::ENABLED && result)
+    {
+      _counters.onMatch();
+    }
+    return result;
+  }
+
+  template <typename T>
+  bool search(T const& customInput, Span& span) const {
+    return search(arrayOfCustom(customInput), span);
+  }
+
+  // Approximate matching: up to maxErrors edits, each the insertion, the
+  // deletion or the substitution of one symbol (a byte with the utf8
+  // option), in time linear in the input for a given maxErrors (see
+  // ApproximateMatcher). The position automaton of the pattern must fit in
+  // a machine word, else std::invalid_argument is thrown. The prefilter
+  // does not apply, since the required string may be misspelt.
+
+  // the fewest edits that turn the whole input into a match, or
+  // maxErrors + 1 if more are needed
+  unsigned distance(SymbolT const* input, unsigned maxErrors) const
+  {
+    return _getApproximate().distance(input, maxErrors);
+  }
+
+  template <typename T>
+  unsigned distance(T const& customInput, unsigned maxErrors) const {
+    return distance(arrayOfCustom(customInput), maxErrors);
+  }
+
+  bool matchApprox(SymbolT const* input, unsigned maxErrors) const
+  {
+    if (CountersT::ENABLED)
+    {
+      _counters.onCall(std::char_traits<SymbolT>::length(input) * sizeof(SymbolT));
+    }
+    bool result = distance(input, maxErrors) <= maxErrors;
+    if (CountersT::ENABLED && result)
+    {
+      _counters.onMatch();
+    }
+    return result;
+  }
+
+  template <typename T>
+  bool matchApprox(T const& customInput, unsigned maxErrors) const {
+    return matchApprox(arrayOfCustom(customInput), maxErrors);
+  }
+
+  // Finds the first substring of the input to end that matches within
+  // maxErrors edits, starting as far left as the fewest errors there
+  // allow; 'span' and 'errors' are only set on success.
+  bool searchApprox(SymbolT const* input, unsigned maxErrors, Span& span,
+    unsigned* errors=nullptr) const
+  {
+    size_t length = std::char_traits<SymbolT>::length(input);
+    if (CountersT::ENABLED)
+    {
+      _counters.onCall(length * sizeof(SymbolT));
+    }
+    Span found;
+    unsigned foundErrors;
+    if (!_getApproximate().search(input, length, maxErrors, found, foundErrors))
+    {
+      return false;
+    }
+    if (CountersT::ENABLED)
+    {
+      _counters.onMatch();
+    }
+    span = found;
+    if (errors != nullptr)
+    {
+      *errors = foundErrors;
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool searchApprox(T const& customInput, unsigned maxErrors, Span& span,
+    unsigned* errors=nullptr) const {
+    return searchApprox(arrayOfCustom(customInput), maxErrors, span, errors);
+  }
+
+  // Iterates over the non-overlapping leftmost-longest matches of the input,
+  // which must outlive the result:
+  //   for (Span const& span : re.findAll(input)) ...
+  Matches<SymbolT> findAll(SymbolT const* input) const
+  {
+    return _findAll(input, std::char_traits<SymbolT>::length(input));
+  }
+
+  template <typename T>
+  Matches<SymbolT> findAll(T const& customInput) const {
+    return findAll(arrayOfCustom(customInput));
+  }
+
+  // the matches would outlive a temporary input
+  template <typename T>
+  Matches<SymbolT> findAll(T const&& customInput) const = delete;
+
+  // Finds the leftmost-longest match like search(), and its capture groups:
+  // groups[0] is the whole match and groups[i] the i-th parenthesis, or
+  // Span::unset() if the group took no part in the match.
+  bool capture(SymbolT const* input, std::vector<Span>& groups) const
+  {
+    Span span;
+    if (!search(input, span))
+    {
+      return false;
+    }
+    _Program const& program = *_program;
+    if (program.captures.groupCount() == 0)
+    {
+      groups.assign(1, span);
+      return true;
+    }
+    // a short span is cheaper to backtrack than to build the DFAs for
+    if (BoundedBacktracker<SymbolT>::fits(program.captures, span))
+    {
+      auto backtracker = program.backtrackers.get();
+      return backtracker->match(program.captures, input, span, groups);
+    }
+    _buildCaptureDFAs();
+    if (program.onePass.isOnePass())
+    {
+      return program.onePass.match(input, span, groups);
+    }
+    if (program.tagged.isBuilt())
+    {
+      return program.tagged.match(input, span, groups);
+    }
+    return program.captures.match(input, span, groups);
+  }
+
+  template <typename T>
+  bool capture(T const& customInput, std::vector<Span>& groups) const {
+    return capture(arrayOfCustom(customInput), groups);
+  }
+
+  unsigned groupCount() const
+  {
+    return _program->captures.groupCount();
+  }
+
+  // Writes the input to 'out' with every match of findAll() replaced, and
+  // returns the iterator past the last symbol written. The symbols between
+  // the matches are copied by whole runs.
+  template <typename OutputIterator>
+  OutputIterator replace(SymbolT const* input,
+    std::basic_string<SymbolT> const& replacement, OutputIterator out) const
+  {
+    _replace(input, replacement, [&out] (SymbolT const* first, SymbolT const* last) {
+      out = std::copy(first, last, out);
+    });
+    return out;
+  }
+
+  template <typename OutputIterator>
+  OutputIterator replace(std::basic_string<SymbolT> const& input,
+    std::basic_string<SymbolT> const& replacement, OutputIterator out) const
+  {
+    return replace(input.c_str(), replacement, out);
+  }
+
+  std::basic_string<SymbolT> replace(SymbolT const* input,
+    std::basic_string<SymbolT> const& replacement) const
+  {
+    std::basic_string<SymbolT> result;
+    _replace(input, replacement, [&result] (SymbolT const* first, SymbolT const* last) {
+      result.append(first, last);
+    });
+    return result;
+  }
+
+  std::basic_string<SymbolT> replace(std::basic_string<SymbolT> const& input,
+    std::basic_string<SymbolT> const& replacement) const
+  {
+    return replace(input.c_str(), replacement);
+  }
+
+  // the counters since the compilation; only the cache flushes and fallbacks
+  // are counted without instrumentation.
+  RegexStats getStats() const
+  {
+    RegexStats stats = _counters.snapshot();
+    stats.cacheFlushes = _cacheStats.flushes;
+    stats.cacheFallbacks = _cacheStats.fallbacks;
+    return stats;
+  }
+
+  CompileOptions const& getOptions() const
+  {
+    return _options;
+  }
+
+  _Engine getEngine() const
+  {
+    return _program->engine;
+  }
+
+  // tells which engine runs the regex, and why.
+  std::string explain() const
+  {
+    _Program const& program = *_program;
+    std::string result = CompileOptions::toString(program.engine);
+    result += ": " + program.reason;
+    if (program.hasPrefilter)
+    {
+      result += "; prefilter: the input must contain a "
+        + std::to_string(program.prefilter.getLiteral().size()) + "-symbol string";
+    }
+    if (program.captures.groupCount() != 0)
+    {
+      _buildCaptureDFAs();
+      result += "; captures: bounded backtracking for the short matches, else ";
+      result += program.onePass.isOnePass() ? "one-pass DFA"
+        : program.tagged.isBuilt() ? "tagged DFA" : "Pike VM";
+    }
+    return result;
+  }
+
+  // Bounds the memory of the lazy DFA cache, in bytes. This copy gets a
+  // cold cache of its own.
+  void setCacheBudget(size_t bytes)
+  {
+    _options.cacheBudget = bytes;
+    _cache = _makeCache();
+  }
+
+  size_t getCacheBudget() const
+  {
+    return _options.cacheBudget;
+  }
+
+  // Lays out the eager DFA by how often the corpus visits its states, so that
+  // the hot ones share the cache lines (see DFA::reorder()). The other
+  // engines are left as they are. This copy gets a program of its own; not to
+  // be called while it is matching.
+  void train(std::vector<std::basic_string<SymbolT>> const& corpus)
+  {
+    if (_program->engine != CompileOptions::EAGER_DFA)
+    {
+      return;
+    }
+    std::shared_ptr<_Program> program = std::make_shared<_Program>(*_program);
+    std::vector<size_t> visits(program->dfa.size(), 0);
+    for (auto const& input : corpus)
+    {
+      program->dfa.countVisits(input.c_str(), visits);
+    }
+    program->dfa.reorder(visits);
+    _program = program;
+  }
+
+  size_t cacheFlushes() const
+  {
+    return _cacheStats.flushes;
+  }
+
+  size_t cacheFallbacks() const
+  {
+    return _cacheStats.fallbacks;
+  }
+
 private:
+  bool _run(SymbolT const* input) const
+  {
+    _Program const& program = *_program;
+    switch (program.engine)
+    {
+      case CompileOptions::LITERAL:       return program.literal.match(input);
+      case CompileOptions::AHO_CORASICK:  return program.ahoCorasick.match(input);
+      case CompileOptions::BIT_PARALLEL:  return program.bitParallel.match(input);
+      case CompileOptions::EAGER_DFA:     return program.dfa.accepts(input);
+      default:
+        return _cache->simulate(input, &_counters, &_cacheStats);
+    }
+  }
+
+  Matches<SymbolT> _findAll(SymbolT const* input, size_t length) const
+  {
+    if (CountersT::ENABLED)
+    {
+      _counters.onCall(length * sizeof(SymbolT));
+    }
+    if (_program->hasPrefilter
+      && _program->prefilter.find(input, input + length) == nullptr)
+    {
+      return Matches<SymbolT>();
+    }
+    switch (_program->engine)
+    {
+      case CompileOptions::LITERAL:
+        return Matches<SymbolT>(_program->literal, input, input + length);
+      case CompileOptions::AHO_CORASICK:
+        return Matches<SymbolT>(_program->ahoCorasick, input, input + length);
+      default:
+        return Matches<SymbolT>(_getSearcher(), input, input + length);
+    }
+  }
+
+  // hands the output to 'append' as ranges of symbols
+  template <typename Append>
+  void _replace(SymbolT const* input,
+    std::basic_string<SymbolT> const& replacement, Append append) const
+  {
+    size_t length = std::char_traits<SymbolT>::length(input);
+    SymbolT const* copied = input;
+    for (Span const& span : _findAll(input, length))
+    {
+      append(copied, input + span.begin);
+      append(replacement.data(), replacement.data() + replacement.size());
+      copied = input + span.end;
+    }
+    append(copied, input + length);
+  }
+
+  void _buildCaptureDFAs() const
+  {
+    _Program const& program = *_program;
+    std::call_once(program.captureDFAsBuilt, [&program] () {
+      program.onePass = OnePassDFA<SymbolT>(program.captures);
+      if (!program.onePass.isOnePass() && program.options.maxDFAStates != 0)
+      {
+        program.tagged = TaggedDFA<SymbolT>(program.captures,
+          program.options.maxDFAStates);
+      }
+    });
+  }
+
+  // the DFA of matchBatch(), or null if the regex does not determinize
+  BatchDFA<SymbolT> const* _getBatchDFA() const
+  {
+    _Program const& program = *_program;
+    std::call_once(program.batchBuilt, [&program] () {
+      if (program.engine == CompileOptions::EAGER_DFA)
+      {
+        program.batch.reset(new BatchDFA<SymbolT>(program.dfa));
+        return;
+      }
+      if (program.options.maxDFAStates == 0)
+      {
+        return;
+      }
+      CompileOptions options = program.options;
+      options.maxCompileTime = std::chrono::milliseconds(0);
+      CompileBudget budget(options);
+      try
+      {
+        DFA<SymbolT> dfa;
+        DFABuilder<SymbolT> builder(program.nfa, dfa, &budget);
+        program.batch.reset(new BatchDFA<SymbolT>(dfa));
+      }
+      catch (ComplexityError const&)
+      {
+      }
+    });
+    return program.batch.get();
+  }
+
+  void _countBatch(size_t const* lengths, size_t count, bool const* results) const
+  {
+    if (CountersT::ENABLED)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        _counters.onCall(lengths[i] * sizeof(SymbolT));
+        if (results[i])
+        {
+          _counters.onMatch();
+        }
+      }
+    }
+  }
+
+  ApproximateMatcher<SymbolT> const& _getApproximate() const
+  {
+    _Program const& program = *_program;
+    std::call_once(program.approximateBuilt, [&program] () {
+      auto npi = parsePattern(program.pattern.c_str(), program.options);
+      if (GlushkovBuilder<SymbolT>::countPositions(npi)
+        <= PositionAutomaton<SymbolT>::MAX_SIZE)
+      {
+        PositionAutomaton<SymbolT> automaton;
+        GlushkovBuilder<SymbolT> glushkov(npi, automaton);
+        program.approximate.reset(new ApproximateMatcher<SymbolT>(automaton));
+      }
+    });
+    if (!program.approximate)
+    {
+      throw std::invalid_argument("the pattern is too long for approximate "
+        "matching");
+    }
+    return *program.approximate;
+  }
+
+  Searcher<SymbolT> const& _getSearcher() const
+  {
+    _Program const& program = *_program;
+    std::call_once(program.searcherBuilt, [&program] () {
+      program.searcher.reset(new Searcher<SymbolT>(program.nfa, program.options));
+    });
+    return *program.searcher;
+  }
+
+  static void _compile(SymbolT const* expr, _Program& program)
+  {
+    CompileBudget budget(program.options);
+    NFABuilder<SymbolT> builder(parsePattern(expr, program.options, &program.captures),
+      program.nfa, &budget);
+    Planner<SymbolT> planner(builder.postfix(), program.options);
+
+    program.engine = planner.getEngine();
+    program.reason = planner.getReason();
+
+    switch (program.engine)
+    {
+      case CompileOptions::LITERAL:
+        program.literal = LiteralMatcher<SymbolT>(planner.getLiterals().front());
+        break;
+
+      case CompileOptions::AHO_CORASICK:
+        program.ahoCorasick = AhoCorasick<SymbolT>(planner.getLiterals());
+        break;
+
+      case CompileOptions::BIT_PARALLEL:
+      {
+        PositionAutomaton<SymbolT> automaton;
+        GlushkovBuilder<SymbolT> glushkov(builder.postfix(), automaton);
+        program.bitParallel = BitParallel<SymbolT>(automaton);
+        break;
+      }
+
+      case CompileOptions::EAGER_DFA:
+        _determinize(budget, program);
+        break;
+
+      default:
+        break;
+    }
+    if (program.engine == CompileOptions::LAZY_DFA)
+    {
+      program.universal = program.nfa.universalStates();
+    }
+
+    if (program.engine != CompileOptions::LITERAL
+      && program.engine != CompileOptions::AHO_CORASICK
+      && !planner.getRequired().empty())
+    {
+      program.prefilter = LiteralMatcher<SymbolT>(planner.getRequired());
+      program.hasPrefilter = true;
+    }
+  }
+
+  static void _determinize(CompileBudget const& budget, _Program& program)
+  {
+    try
+    {
+      DFABuilder<SymbolT> dfaBuilder(program.nfa, program.dfa, &budget);
+    }
+    catch (ComplexityError const& e)
+    {
+      if (e.getLimit() != ComplexityError::DFA_STATES
+        || program.options.failOnDFAStates)
+      {
+        throw;
+      }
+      program.dfa = DFA<SymbolT>();
+      program.engine = CompileOptions::LAZY_DFA;
+      program.reason += "; the DFA has more than "
+        + std::to_string(program.options.maxDFAStates)
+        + " states, so it is built lazily";
+    }
+  }
+
+  bool _passPrefilter(SymbolT const* input) const
+  {
+    SymbolT const* end = input + std::char_traits<SymbolT>::length(input);
+    return _program->prefilter.find(input, end) != nullptr;
+  }
+
+  std::shared_ptr<LazyDFACache<SymbolT>> _makeCache() const
+  {
+    if (_program->engine != CompileOptions::LAZY_DFA)
+    {
+      return nullptr;
+    }
+    return std::make_shared<LazyDFACache<SymbolT>>(_program->nfa,
+      _program->universal, _options.cacheBudget);
+  }
+
+  static BoundedBacktracker<SymbolT>* _backtrackerFactory()
+  {
+    return new BoundedBacktracker<SymbolT>();
+  }
+
+  static SymbolT const* arrayOfCustom(std::basic_string<SymbolT> const& str)
+  {
+    return str.c_str();
+  }
+
   template <typename T>
   static SymbolT const* arrayOfCustom(T const& custom)
   {
@@ -66,4 +822,7 @@ private:
 
 };
 
+template <typename SymbolT, typename CountersT>
+const size_t RegexBase<SymbolT, CountersT>::_BATCH_BLOCK;
+
 #endif // REGEX_BASE_H
@@ -0,0 +1,211 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef REGEX_STATS_H
+#define REGEX_STATS_H
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+// A snapshot of the runtime counters of a regex.
+struct RegexStats
+{
+  size_t calls = 0;
+  size_t bytesScanned = 0;
+  size_t matches = 0;
+  size_t nfaStatesVisited = 0;
+  size_t epsilonClosureWork = 0;
+  size_t cacheHits = 0;
+  size_t cacheMisses = 0;
+  size_t cacheFlushes = 0;
+  size_t cacheFallbacks = 0;
+  size_t prefilterChecks = 0;
+  size_t prefilterCandidates = 0;
+  size_t prefilterConfirms = 0;
+
+  std::string toJSON() const
+  {
+    std::ostringstream out;
+    char const* separator = "{";
+    _forEach([&] (char const* name, size_t value) {
+      out << separator << "\"" << name << "\": " << value;
+      separator = ", ";
+    });
+    out << "}";
+    return out.str();
+  }
+
+  // Prometheus text exposition format, every counter labelled by the
+  // pattern.
+  std::string toPrometheus(std::string const& pattern) const
+  {
+    std::string label = "{pattern=\"" + _escape(pattern) + "\"}";
+    std::ostringstream out;
+    _forEach([&] (char const* name, size_t value) {
+      out << "# TYPE regex_" << name << "_total counter\n"
+        << "regex_" << name << "_total" << label << ' ' << value << '\n';
+    });
+    return out.str();
+  }
+
+private:
+  template <typename F>
+  void _forEach(F f) const
+  {
+    f("calls", calls);
+    f("bytes_scanned", bytesScanned);
+    f("matches", matches);
+    f("nfa_states_visited", nfaStatesVisited);
+    f("epsilon_closure_work", epsilonClosureWork);
+    f("cache_hits", cacheHits);
+    f("cache_misses", cacheMisses);
+    f("cache_flushes", cacheFlushes);
+    f("cache_fallbacks", cacheFallbacks);
+    f("prefilter_checks", prefilterChecks);
+    f("prefilter_candidates", prefilterCandidates);
+    f("prefilter_confirms", prefilterConfirms);
+  }
+
+  static std::string _escape(std::string const& str)
+  {
+    std::string result;
+    for (char c : str)
+    {
+      switch (c)
+      {
+        case '\\':  result += "\\\\";  break;
+        case '"':   result += "\\\"";  break;
+        case '\n':  result += "\\n";   break;
+        default:    result += c;       break;
+      }
+    }
+    return result;
+  }
+};
+
+// Counters policies, given as template parameter to the engines. The hooks
+// are only called under 'if (CountersT::ENABLED)', so that NullCounters
+// compiles them out of the hot loops.
+struct NullCounters
+{
+  static const bool ENABLED = false;
+
+  void onCall(size_t) {}
+  void onMatch() {}
+  void onNFAStates(size_t) {}
+  void onClosure(size_t) {}
+  void onCacheHit() {}
+  void onCacheMiss() {}
+  void onPrefilter(bool) {}
+  void onConfirm() {}
+
+  RegexStats snapshot() const
+  {
+    return RegexStats();
+  }
+};
+
+// Relaxed atomics: several threads may match with the same regex.
+struct AtomicCounters
+{
+  static const bool ENABLED = true;
+
+  std::atomic<size_t> calls { 0 };
+  std::atomic<size_t> bytesScanned { 0 };
+  std::atomic<size_t> matches { 0 };
+  std::atomic<size_t> nfaStatesVisited { 0 };
+  std::atomic<size_t> epsilonClosureWork { 0 };
+  std::atomic<size_t> cacheHits { 0 };
+  std::atomic<size_t> cacheMisses { 0 };
+  std::atomic<size_t> prefilterChecks { 0 };
+  std::atomic<size_t> prefilterCandidates { 0 };
+  std::atomic<size_t> prefilterConfirms { 0 };
+
+  void onCall(size_t bytes)
+  {
+    _add(calls, 1);
+    _add(bytesScanned, bytes);
+  }
+
+  void onMatch()
+  {
+    _add(matches, 1);
+  }
+
+  void onNFAStates(size_t count)
+  {
+    _add(nfaStatesVisited, count);
+  }
+
+  void onClosure(size_t work)
+  {
+    _add(epsilonClosureWork, work);
+  }
+
+  void onCacheHit()
+  {
+    _add(cacheHits, 1);
+  }
+
+  void onCacheMiss()
+  {
+    _add(cacheMisses, 1);
+  }
+
+  void onPrefilter(bool candidate)
+  {
+    _add(prefilterChecks, 1);
+    if (candidate)
+    {
+      _add(prefilterCandidates, 1);
+    }
+  }
+
+  void onConfirm()
+  {
+    _add(prefilterConfirms, 1);
+  }
+
+  RegexStats snapshot() const
+  {
+    RegexStats stats;
+    stats.calls = calls.load(std::memory_order_relaxed);
+    stats.bytesScanned = bytesScanned.load(std::memory_order_relaxed);
+    stats.matches = matches.load(std::memory_order_relaxed);
+    stats.nfaStatesVisited = nfaStatesVisited.load(std::memory_order_relaxed);
+    stats.epsilonClosureWork = epsilonClosureWork.load(std::memory_order_relaxed);
+    stats.cacheHits = cacheHits.load(std::memory_order_relaxed);
+    stats.cacheMisses = cacheMisses.load(std::memory_order_relaxed);
+    stats.prefilterChecks = prefilterChecks.load(std::memory_order_relaxed);
+    stats.prefilterCandidates = prefilterCandidates.load(std::memory_order_relaxed);
+    stats.prefilterConfirms = prefilterConfirms.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+private:
+  static void _add(std::atomic<size_t>& counter, size_t value)
+  {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+};
+
+#endif // REGEX_STATS_H
@@ -0,0 +1,318 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SEARCHER_H
+#define SEARCHER_H
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "NFA.h"
+#include "DFA.h"
+#include "DFABuilder.h"
+#include "CompileOptions.h"
+#include "Span.h"
+
+// Finds the leftmost-longest match of a regex inside an input, at DFA speed.
+// The start of the match is the last position where the DFA of the reversed
+// and unanchored regex accepts, scanning backward from the end of the input;
+// its end is the last position where the DFA of the regex accepts, scanning
+// forward from that start. An automaton whose DFA exceeds maxDFAStates is
+// simulated as an NFA instead, like every automaton if maxDFAStates is 0.
+// To find all the matches, the backward scan runs once and keeps every start
+// it reaches, and each match only costs its forward scan.
+template <typename SymbolT>
+class Searcher
+{
+private:
+  typedef std::reverse_iterator<SymbolT const*> _Backward;
+
+  // one direction of the search
+  class _Scanner
+  {
+  private:
+    NFA<SymbolT> _nfa;
+    DFA<SymbolT> _dfa;
+    bool _determinized = false;
+    std::vector<bool> _universal; // NFA only
+
+  public:
+    _Scanner(NFA<SymbolT> const& nfa, CompileOptions const& options) :
+      _nfa(nfa)
+    {
+      if (options.maxDFAStates != 0)
+      {
+        CompileBudget budget(options);
+        try
+        {
+          DFABuilder<SymbolT> builder(_nfa, _dfa, &budget);
+          _determinized = true;
+          return;
+        }
+        catch (ComplexityError const&)
+        {
+          _dfa = DFA<SymbolT>();
+        }
+      }
+      _universal = _nfa.universalStates();
+    }
+
+    bool isDeterminized() const
+    {
+      return _determinized;
+    }
+
+    // Reads [first, last) and sets 'matchEnd' after the last symbol read in
+    // an accepting state (to 'first' if the initial state accepts). Returns
+    // false if no state read accepts.
+    template <typename Iterator>
+    bool lastAccept(Iterator first, Iterator last, Iterator& matchEnd) const
+    {
+      return _determinized ? _lastAcceptDFA(first, last, matchEnd)
+        : _lastAcceptNFA(first, last, matchEnd);
+    }
+
+    // Reads [first, last) and sets marks[i] when the state after the first i
+    // symbols accepts; 'marks' holds a flag for each position of the range.
+    template <typename Iterator>
+    void markAccepts(Iterator first, Iterator last, std::vector<bool>& marks) const
+    {
+      if (_determinized)
+      {
+        _markAcceptsDFA(first, last, marks);
+      }
+      else
+      {
+        _markAcceptsNFA(first, last, marks);
+      }
+    }
+
+  private:
+    template <typename Iterator>
+    void _markAcceptsDFA(Iterator first, Iterator last,
+      std::vector<bool>& marks) const
+    {
+      DStateId state = _dfa.getInitial();
+      size_t i = 0;
+      marks[i] = _dfa.isAcceptor(state);
+      for (Iterator it = first; it != last && !_dfa.isDecided(state); ++it)
+      {
+        state = _dfa.next(state, *it);
+        marks[++i] = _dfa.isAcceptor(state);
+      }
+      if (_dfa.isDecided(state) && _dfa.isAcceptor(state))
+      {
+        std::fill(marks.begin() + i, marks.end(), true); // accepts forever
+      }
+    }
+
+    template <typename Iterator>
+    void _markAcceptsNFA(Iterator first, Iterator last,
+      std::vector<bool>& marks) const
+    {
+      std::vector<StateId> states { _nfa.getInitial() };
+      std::vector<StateId> next;
+      std::vector<bool> visited;
+      _nfa.epsilonClosure(states, visited);
+
+      size_t i = 0;
+      marks[i] = _accepts(states);
+      for (Iterator it = first; it != last && !states.empty(); ++it)
+      {
+        if (_isUniversal(states))
+        {
+          std::fill(marks.begin() + i, marks.end(), true);
+          return;
+        }
+        _step(states, *it, next, visited);
+        marks[++i] = _accepts(states);
+      }
+    }
+
+    template <typename Iterator>
+    bool _lastAcceptDFA(Iterator first, Iterator last, Iterator& matchEnd) const
+    {
+      DStateId state = _dfa.getInitial();
+      bool found = _dfa.isAcceptor(state);
+      matchEnd = first;
+      for (Iterator it = first; it != last && !_dfa.isDecided(state); )
+      {
+        state = _dfa.next(state, *it);
+        ++it;
+        if (_dfa.isAcceptor(state))
+        {
+          found = true;
+          matchEnd = it;
+        }
+      }
+      if (_dfa.isDecided(state) && _dfa.isAcceptor(state))
+      {
+        matchEnd = last; // accepts forever
+      }
+      return found;
+    }
+
+    template <typename Iterator>
+    bool _lastAcceptNFA(Iterator first, Iterator last, Iterator& matchEnd) const
+    {
+      std::vector<StateId> states { _nfa.getInitial() };
+      std::vector<StateId> next;
+      std::vector<bool> marks;
+      _nfa.epsilonClosure(states, marks);
+
+      bool found = _accepts(states);
+      matchEnd = first;
+      for (Iterator it = first; it != last && !states.empty(); )
+      {
+        if (_isUniversal(states))
+        {
+          matchEnd = last;
+          return true;
+        }
+        _step(states, *it, next, marks);
+        ++it;
+        if (_accepts(states))
+        {
+          found = true;
+          matchEnd = it;
+        }
+      }
+      return found;
+    }
+
+    // replaces 'states' by the closure of their transitions on 'symbol'
+    void _step(std::vector<StateId>& states, SymbolT symbol,
+      std::vector<StateId>& next, std::vector<bool>& marks) const
+    {
+      next.clear();
+      marks.assign(_nfa.size(), false);
+      for (auto state : states)
+      {
+        _nfa.forEachTransition(state, symbol, [&] (StateId target) {
+          if (!marks[target])
+          {
+            marks[target] = true;
+            next.push_back(target);
+          }
+        });
+      }
+      _nfa.epsilonClosure(next, marks);
+      states.swap(next);
+    }
+
+    bool _isUniversal(std::vector<StateId> const& states) const
+    {
+      for (auto state : states)
+      {
+        if (_universal[state])
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool _accepts(std::vector<StateId> const& states) const
+    {
+      for (auto state : states)
+      {
+        if (_nfa.isAcceptor(state))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  _Scanner _forward;
+  _Scanner _backward;
+
+public:
+  Searcher(NFA<SymbolT> const& nfa, CompileOptions const& options) :
+    _forward(nfa, _searchOptions(options)),
+    _backward(nfa.reversed().unanchored(), _searchOptions(options))
+  {}
+
+  bool isDeterminized() const
+  {
+    return _forward.isDeterminized() && _backward.isDeterminized();
+  }
+
+  // finds the leftmost-longest match in [begin, end)
+  bool search(SymbolT const* begin, SymbolT const* end, Span& span) const
+  {
+    _Backward start;
+    if (!_backward.lastAccept(_Backward(end), _Backward(begin), start))
+    {
+      return false;
+    }
+    SymbolT const* matchBegin = start.base();
+    SymbolT const* matchEnd;
+    _forward.lastAccept(matchBegin, end, matchEnd);
+
+    span.begin = matchBegin - begin;
+    span.end = matchEnd - begin;
+    return true;
+  }
+
+  // Marks the positions of [begin, end] where a match starts, in a single
+  // backward scan: starts[i] for the position end - i.
+  void findStarts(SymbolT const* begin, SymbolT const* end,
+    std::vector<bool>& starts) const
+  {
+    starts.assign(end - begin + 1, false);
+    _backward.markAccepts(_Backward(end), _Backward(begin), starts);
+  }
+
+  // Finds the leftmost-longest match of [begin, end) which starts at 'from'
+  // or after, given the starts found by findStarts().
+  bool searchFrom(SymbolT const* begin, SymbolT const* end,
+    std::vector<bool> const& starts, size_t from, Span& span) const
+  {
+    size_t length = end - begin;
+    for (size_t i = length - from + 1; i-- > 0; )
+    {
+      if (starts[i])
+      {
+        SymbolT const* matchBegin = end - i;
+        SymbolT const* matchEnd;
+        _forward.lastAccept(matchBegin, end, matchEnd);
+        span.begin = matchBegin - begin;
+        span.end = matchEnd - begin;
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  // the compilation limits but the DFA size do not apply any more
+  static CompileOptions _searchOptions(CompileOptions options)
+  {
+    options.maxNFAStates = 0;
+    options.maxCompileTime = std::chrono::milliseconds(0);
+    return options;
+  }
+};
+
+#endif // SEARCHER_H
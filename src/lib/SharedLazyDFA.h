@@ -0,0 +1,547 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SHARED_LAZY_DFA_H
+#define SHARED_LAZY_DFA_H
+
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "NFA.h"
+#include "NFASimulator.h"
+#include "HotSwap.h"
+#include "Lexemes.h"
+#include "RegexStats.h"
+#include "SymbolClasses.h"
+
+// Counters shared by every cache of a same regex.
+struct LazyDFAStats
+{
+  std::atomic<size_t> flushes;
+  std::atomic<size_t> fallbacks;
+
+  LazyDFAStats() :
+    flushes(0), fallbacks(0)
+  {}
+};
+
+template <typename SymbolT>
+class LazyDFACache;
+
+// A DFA built on demand: each DFA state is an epsilon-closed set of NFA
+// states and its transitions are only computed the first time they are
+// followed. They are stored as a row per state, with a column per class of
+// symbols of the NFA (see SymbolClasses). The scan stops early on a dead
+// state (no NFA state left) or an accept-forever one (see
+// NFA::universalStates()).
+//
+// The cache is shared by every thread, so that they warm it together. A
+// transition is published with a compare-and-swap once computed, and is
+// then followed without any lock. A new state is interned under the lock of
+// one shard of the index, chosen by its hash, so that the threads which
+// discover states at the same time seldom wait for each other.
+//
+// The states are never freed, since a reader may be on any of them: once
+// the memory budget is spent, simulate() hands over to the NFASimulator
+// where a new state would be needed, and LazyDFACache flushes by replacing
+// the whole cache. The NFA and its universal states must outlive the cache.
+template <typename SymbolT>
+class SharedLazyDFA
+{
+public:
+  static const size_t DEFAULT_MEMORY_BUDGET = 1 << 20;
+
+private:
+  friend class LazyDFACache<SymbolT>;
+
+  typedef unsigned int _DStateId;
+
+  static const _DStateId _UNKNOWN = std::numeric_limits<_DStateId>::max();
+  static const _DStateId _FULL = std::numeric_limits<_DStateId>::max() - 1;
+
+  // a published transition carries this bit if its target is decided, so
+  // that a step reads nothing but the transition
+  static const _DStateId _DECIDED = _UNKNOWN - (_UNKNOWN >> 1);
+  static const _DStateId _MAX_STATES = (_UNKNOWN >> 1) - 1;
+
+  // approximate cost of the bookkeeping of a state, the rb-tree node of the
+  // index included.
+  static const size_t _STATE_COST = 128;
+
+  // the states are allocated by chunks, which never move
+  static const size_t _CHUNK_STATES = 256;
+  static const size_t _SHARDS = 64;
+
+  struct _DState
+  {
+    std::vector<StateId> nfaStates; // sorted
+    bool accepting = false;
+    bool decided = false; // dead or accept-forever
+  };
+
+  struct _Chunk
+  {
+    _DState states[_CHUNK_STATES];
+    std::unique_ptr<std::atomic<_DStateId>[]> transitions;
+
+    explicit _Chunk(size_t columns) :
+      transitions(new std::atomic<_DStateId>[_CHUNK_STATES * columns])
+    {
+      for (size_t i = 0; i < _CHUNK_STATES * columns; i++)
+      {
+        transitions[i].store(_UNKNOWN, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  struct _Shard
+  {
+    std::mutex mutex;
+    std::map<std::vector<StateId>, _DStateId> index;
+  };
+
+  // scratch space of the subset construction, one per scan
+  struct _Scratch
+  {
+    std::vector<bool> marks;
+    std::vector<StateId> buffer;
+  };
+
+  NFA<SymbolT> const& _nfa;
+  std::vector<bool> const& _universal;
+  SymbolClasses<SymbolT> _classes;
+  size_t _columns;
+
+  size_t _memoryBudget;
+  mutable std::atomic<size_t> _memoryUsage;
+  mutable std::atomic<_DStateId> _nextState;
+
+  size_t _maxChunks;
+  std::unique_ptr<std::atomic<_Chunk*>[]> _chunks;
+  mutable _Shard _shards[_SHARDS];
+
+  // set by LazyDFACache once the scans thrash on this cache
+  mutable std::atomic<bool> _thrashing;
+  mutable std::atomic<size_t> _thrashFallbacks;
+
+public:
+  SharedLazyDFA(NFA<SymbolT> const& nfa, std::vector<bool> const& universal,
+    size_t memoryBudget=DEFAULT_MEMORY_BUDGET) :
+    _nfa(nfa),
+    _universal(universal),
+    _classes(nfa.classStarts()),
+    _columns(_classes.size()),
+    _memoryBudget(memoryBudget),
+    _memoryUsage(0),
+    _nextState(0),
+    _maxChunks(std::min<size_t>(_MAX_STATES / _CHUNK_STATES,
+      memoryBudget / (_STATE_COST + _columns * sizeof(_DStateId)) / _CHUNK_STATES + 1)),
+    _chunks(new std::atomic<_Chunk*>[_maxChunks]),
+    _thrashing(false),
+    _thrashFallbacks(0)
+  {
+    for (size_t i = 0; i < _maxChunks; i++)
+    {
+      _chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+    // the start state is 0, whatever the budget
+    _Scratch scratch;
+    scratch.buffer.push_back(nfa.getInitial());
+    nfa.epsilonClosure(scratch.buffer, scratch.marks);
+    _addState(scratch.buffer, true);
+  }
+
+  SharedLazyDFA(SharedLazyDFA const&) = delete;
+  void operator=(SharedLazyDFA const&) = delete;
+
+  ~SharedLazyDFA()
+  {
+    for (size_t i = 0; i < _maxChunks; i++)
+    {
+      delete _chunks[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  size_t memoryUsage() const
+  {
+    return _memoryUsage;
+  }
+
+  size_t stateCount() const
+  {
+    return std::min(static_cast<size_t>(_nextState), _maxChunks * _CHUNK_STATES);
+  }
+
+  // Safe to call from any number of threads at once. The fallbacks to the
+  // NFASimulator are counted in 'stats', if given.
+  template <typename CountersT>
+  bool simulate(SymbolT const* input, CountersT* counters=nullptr,
+    LazyDFAStats* stats=nullptr) const
+  {
+    _Scratch scratch;
+    _DStateId current = 0;
+    if (_scan(input, current, scratch, counters))
+    {
+      return _state(current).accepting;
+    }
+    if (stats != nullptr)
+    {
+      stats->fallbacks++;
+    }
+    return _fallback(_state(current).nfaStates, input, counters);
+  }
+
+private:
+  _Chunk* _chunk(_DStateId id) const
+  {
+    return _chunks[id / _CHUNK_STATES].load(std::memory_order_acquire);
+  }
+
+  _DState const& _state(_DStateId id) const
+  {
+    return _chunk(id)->states[id % _CHUNK_STATES];
+  }
+
+  std::atomic<_DStateId>* _row(_DStateId id) const
+  {
+    return _chunk(id)->transitions.get() + (id % _CHUNK_STATES) * _columns;
+  }
+
+  // Runs the input from 'current' until its end or a decided state, and
+  // returns true with 'current' the last state. Returns false if a new state
+  // would exceed the budget, with 'input' and 'current' where it stopped.
+  template <typename CountersT>
+  bool _scan(SymbolT const*& input, _DStateId& current, _Scratch& scratch,
+    CountersT* counters) const
+  {
+    if (_state(current).decided)
+    {
+      return true;
+    }
+    // in locals, which the loop keeps in registers
+    SymbolT const* symbol = input;
+    _DStateId state = current;
+    bool finished = true;
+    std::atomic<_DStateId>* row = _row(state);
+    for (; *symbol != Lexemes<SymbolT>::END; symbol++)
+    {
+      std::atomic<_DStateId>& transition = row[_classes.classOf(*symbol)];
+      _DStateId next = transition.load(std::memory_order_acquire);
+      if (CountersT::ENABLED && counters != nullptr)
+      {
+        if (next == _UNKNOWN)
+        {
+          counters->onCacheMiss();
+        }
+        else
+        {
+          counters->onCacheHit();
+        }
+      }
+      if (next == _UNKNOWN)
+      {
+        next = _computeTransition(state, *symbol, scratch, counters);
+        if (next == _FULL)
+        {
+          finished = false;
+          break;
+        }
+        // another thread may have published it first, with the same target
+        _DStateId expected = _UNKNOWN;
+        transition.compare_exchange_strong(expected, next,
+          std::memory_order_release, std::memory_order_relaxed);
+      }
+      state = next & ~_DECIDED;
+      if (next & _DECIDED)
+      {
+        break;
+      }
+      row = _row(state);
+    }
+    input = symbol;
+    current = state;
+    return finished;
+  }
+
+  template <typename CountersT>
+  _DStateId _computeTransition(_DStateId from, SymbolT symbol,
+    _Scratch& scratch, CountersT* counters) const
+  {
+    auto const& set = _state(from).nfaStates;
+    scratch.buffer.clear();
+    scratch.marks.assign(_nfa.size(), false);
+    for (auto nfaState : set)
+    {
+      _nfa.forEachTransition(nfaState, symbol, [&scratch] (StateId reachable) {
+        if (!scratch.marks[reachable])
+        {
+          scratch.marks[reachable] = true;
+          scratch.buffer.push_back(reachable);
+        }
+      });
+    }
+    _nfa.epsilonClosure(scratch.buffer, scratch.marks);
+    if (CountersT::ENABLED && counters != nullptr)
+    {
+      counters->onNFAStates(set.size());
+      counters->onClosure(scratch.buffer.size());
+    }
+    _DStateId to = _addState(scratch.buffer, false);
+    return to == _FULL || !_state(to).decided ? to : to | _DECIDED;
+  }
+
+  // the id of the state of 'set', or _FULL if it is new and the budget is
+  // spent
+  _DStateId _addState(std::vector<StateId> const& set, bool force) const
+  {
+    _Shard& shard = _shards[_hash(set) % _SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(set);
+    if (it != shard.index.end())
+    {
+      return it->second;
+    }
+
+    size_t cost = _STATE_COST + 2 * set.size() * sizeof(StateId)
+      + _columns * sizeof(_DStateId);
+    if (!force && _memoryUsage + cost > _memoryBudget)
+    {
+      return _FULL;
+    }
+    _DStateId id = _nextState++;
+    if (id >= _maxChunks * _CHUNK_STATES)
+    {
+      return _FULL;
+    }
+    _memoryUsage += cost;
+
+    _Chunk* chunk = _chunk(id);
+    if (chunk == nullptr)
+    {
+      // the states of a chunk may be added under different shard locks
+      std::unique_ptr<_Chunk> created(new _Chunk(_columns));
+      if (_chunks[id / _CHUNK_STATES].compare_exchange_strong(chunk, created.get(),
+        std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        chunk = created.release();
+      }
+    }
+
+    _DState& state = chunk->states[id % _CHUNK_STATES];
+    state.nfaStates = set;
+    state.decided = set.empty();
+    for (auto nfaState : set)
+    {
+      state.accepting = state.accepting || _nfa.isAcceptor(nfaState);
+      state.decided = state.decided || _universal[nfaState];
+    }
+    shard.index.emplace(set, id);
+    return id;
+  }
+
+  static size_t _hash(std::vector<StateId> const& set)
+  {
+    size_t hash = 14695981039346656037ULL;
+    for (auto state : set)
+    {
+      hash = (hash ^ state) * 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  template <typename CountersT>
+  bool _fallback(std::vector<StateId> const& set, SymbolT const* remaining,
+    CountersT* counters) const
+  {
+    NFASimulator<SymbolT, CountersT> simulator(counters, &_universal);
+    return simulator.simulate(_nfa, StateSet(set.begin(), set.end()), remaining);
+  }
+};
+
+template <typename SymbolT>
+const size_t SharedLazyDFA<SymbolT>::DEFAULT_MEMORY_BUDGET;
+
+template <typename SymbolT>
+const typename SharedLazyDFA<SymbolT>::_DStateId SharedLazyDFA<SymbolT>::_UNKNOWN;
+
+template <typename SymbolT>
+const typename SharedLazyDFA<SymbolT>::_DStateId SharedLazyDFA<SymbolT>::_FULL;
+
+template <typename SymbolT>
+const typename SharedLazyDFA<SymbolT>::_DStateId SharedLazyDFA<SymbolT>::_DECIDED;
+
+template <typename SymbolT>
+const typename SharedLazyDFA<SymbolT>::_DStateId SharedLazyDFA<SymbolT>::_MAX_STATES;
+
+template <typename SymbolT>
+const size_t SharedLazyDFA<SymbolT>::_STATE_COST;
+
+template <typename SymbolT>
+const size_t SharedLazyDFA<SymbolT>::_CHUNK_STATES;
+
+template <typename SymbolT>
+const size_t SharedLazyDFA<SymbolT>::_SHARDS;
+
+// The lazy DFA cache of a regex, shared by its copies. When the budget of
+// the current SharedLazyDFA is spent, the scan that finds it full replaces
+// it with a fresh one and goes on from the state it had reached: that is a
+// flush. The current cache is published through a HotSwap, so a scan pins
+// it without a lock, and a replaced cache is freed once the scans that
+// started on it are over; a flush may wait for the scans that started two
+// flushes before.
+//
+// When a scan flushes maxFlushes times within FLUSH_WINDOW symbols, the
+// cache is thrashing: the scan hands over to the NFASimulator, which does
+// not allocate, and so do the later scans that find this cache full, but
+// every _RETRY_FALLBACKS-th of them, which flushes to try a fresh cache.
+template <typename SymbolT>
+class LazyDFACache
+{
+public:
+  static const unsigned DEFAULT_MAX_FLUSHES = 4;
+  static const size_t FLUSH_WINDOW = 1 << 16;
+
+private:
+  typedef SharedLazyDFA<SymbolT> _Cache;
+  typedef typename _Cache::_DStateId _DStateId;
+
+  static const size_t _RETRY_FALLBACKS = 1024;
+
+  NFA<SymbolT> const& _nfa;
+  std::vector<bool> const& _universal;
+  size_t _memoryBudget;
+  unsigned _maxFlushes;
+  mutable HotSwap<_Cache> _current;
+
+public:
+  LazyDFACache(NFA<SymbolT> const& nfa, std::vector<bool> const& universal,
+    size_t memoryBudget=_Cache::DEFAULT_MEMORY_BUDGET,
+    unsigned maxFlushes=DEFAULT_MAX_FLUSHES) :
+    _nfa(nfa),
+    _universal(universal),
+    _memoryBudget(memoryBudget),
+    _maxFlushes(maxFlushes),
+    _current(std::unique_ptr<_Cache>(new _Cache(nfa, universal, memoryBudget)))
+  {}
+
+  LazyDFACache(LazyDFACache const&) = delete;
+  void operator=(LazyDFACache const&) = delete;
+
+  // of the current cache
+  size_t memoryUsage() const
+  {
+    return _current.read()->memoryUsage();
+  }
+
+  size_t stateCount() const
+  {
+    return _current.read()->stateCount();
+  }
+
+  // Safe to call from any number of threads at once. The flushes and the
+  // fallbacks to the NFASimulator are counted in 'stats', if given.
+  template <typename CountersT>
+  bool simulate(SymbolT const* input, CountersT* counters=nullptr,
+    LazyDFAStats* stats=nullptr) const
+  {
+    typename _Cache::_Scratch scratch;
+    std::vector<StateId> set;
+    bool resumed = false;
+    SymbolT const* window = input;
+    unsigned flushes = 0;
+    for (;;)
+    {
+      _Cache const* full = nullptr;
+      {
+        auto reader = _current.read();
+        _Cache const& cache = *reader;
+        _DStateId current = 0;
+        if (resumed)
+        {
+          current = cache._addState(set, true);
+          if (current == _Cache::_FULL)
+          {
+            return _fallback(cache, set, input, counters, stats);
+          }
+        }
+        if (cache._scan(input, current, scratch, counters))
+        {
+          return cache._state(current).accepting;
+        }
+
+        if (static_cast<size_t>(input - window) >= FLUSH_WINDOW)
+        {
+          window = input;
+          flushes = 0;
+        }
+        set = cache._state(current).nfaStates;
+        if (flushes == _maxFlushes)
+        {
+          cache._thrashing = true;
+          return _fallback(cache, set, input, counters, stats);
+        }
+        if (cache._thrashing
+          && ++cache._thrashFallbacks % _RETRY_FALLBACKS != 0)
+        {
+          return _fallback(cache, set, input, counters, stats);
+        }
+        full = &cache;
+      }
+
+      // unpinned, so as not to wait for itself; only the first scan to find
+      // this cache full replaces it, the others go on with its replacement
+      flushes++;
+      resumed = true;
+      std::unique_ptr<_Cache> fresh(new _Cache(_nfa, _universal, _memoryBudget));
+      if (_current.replace(full, std::move(fresh)) && stats != nullptr)
+      {
+        stats->flushes++;
+      }
+    }
+  }
+
+private:
+  template <typename CountersT>
+  static bool _fallback(_Cache const& cache, std::vector<StateId> const& set,
+    SymbolT const* remaining, CountersT* counters, LazyDFAStats* stats)
+  {
+    if (stats != nullptr)
+    {
+      stats->fallbacks++;
+    }
+    return cache._fallback(set, remaining, counters);
+  }
+};
+
+template <typename SymbolT>
+const unsigned LazyDFACache<SymbolT>::DEFAULT_MAX_FLUSHES;
+
+template <typename SymbolT>
+const size_t LazyDFACache<SymbolT>::FLUSH_WINDOW;
+
+template <typename SymbolT>
+const size_t LazyDFACache<SymbolT>::_RETRY_FALLBACKS;
+
+#endif // SHARED_LAZY_DFA_H
@@ -0,0 +1,62 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+
+// The position of a match in an input: the symbols [begin, end).
+struct Span
+{
+  size_t begin = 0;
+  size_t end = 0;
+
+  // the span of a capture group which took no part in the match
+  static Span unset()
+  {
+    Span span;
+    span.begin = span.end = static_cast<size_t>(-1);
+    return span;
+  }
+
+  bool isSet() const
+  {
+    return begin != static_cast<size_t>(-1);
+  }
+
+  size_t length() const
+  {
+    return end - begin;
+  }
+
+  bool operator==(Span const& other) const
+  {
+    return begin == other.begin && end == other.end;
+  }
+
+  bool operator!=(Span const& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+#endif // SPAN_H
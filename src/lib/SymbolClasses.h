@@ -0,0 +1,150 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SYMBOL_CLASSES_H
+#define SYMBOL_CLASSES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include "SymbolRanges.h"
+
+// A partition of the symbols into classes that no transition of an
+// automaton tells apart, so that tables get one column per class rather
+// than one per symbol. Class i > 0 starts at the symbol _starts[i - 1];
+// class 0 holds the symbols below _starts[0].
+//
+// The lookup is chosen by the width of the symbols at compile time: the
+// 8-bit symbols index a table of the 256 of them, the wider ones are found
+// by a binary search over the class starts.
+template <typename SymbolT>
+class SymbolClasses
+{
+public:
+  static const bool DENSE = sizeof(SymbolT) == 1;
+  static const size_t BYTE_VALUES = 256;
+
+private:
+  typedef std::integral_constant<bool, DENSE> _Dense;
+
+  std::vector<SymbolT> _starts;
+  std::vector<uint32_t> _byteClasses; // DENSE only
+
+public:
+  SymbolClasses()
+  {
+    _index(_Dense());
+  }
+
+  // 'starts' holds the first symbol of every class
+  explicit SymbolClasses(std::set<SymbolT> const& starts) :
+    _starts(starts.begin(), starts.end())
+  {
+    _index(_Dense());
+  }
+
+  // adds to 'starts' the boundaries of the range [low, high]
+  static void split(std::set<SymbolT>& starts, SymbolT low, SymbolT high)
+  {
+    starts.insert(low);
+    if (high != SymbolRanges<SymbolT>::max())
+    {
+      starts.insert(static_cast<SymbolT>(high + 1));
+    }
+  }
+
+  static void split(std::set<SymbolT>& starts, SymbolRanges<SymbolT> const& ranges)
+  {
+    for (auto const& range : ranges.get())
+    {
+      split(starts, range.first, range.second);
+    }
+  }
+
+  size_t size() const
+  {
+    return _starts.size() + 1;
+  }
+
+  size_t classOf(SymbolT symbol) const
+  {
+    return _classOf(symbol, _Dense());
+  }
+
+  // the class of each byte, for the DENSE symbols
+  uint32_t const* byteClasses() const
+  {
+    return _byteClasses.data();
+  }
+
+  // a symbol of the class; class 0 may be empty, then its representative
+  // belongs to class 1, which is harmless.
+  SymbolT representative(size_t cls) const
+  {
+    return cls == 0 ? SymbolRanges<SymbolT>::min() : _starts[cls - 1];
+  }
+
+private:
+  size_t _search(SymbolT symbol) const
+  {
+    return std::upper_bound(_starts.begin(), _starts.end(), symbol) - _starts.begin();
+  }
+
+  size_t _classOf(SymbolT symbol, std::true_type) const
+  {
+    return _byteClasses[static_cast<unsigned char>(symbol)];
+  }
+
+  size_t _classOf(SymbolT symbol, std::false_type) const
+  {
+    return _search(symbol);
+  }
+
+  void _index(std::true_type)
+  {
+    // one sweep in the order of the symbols
+    _byteClasses.resize(BYTE_VALUES);
+    uint32_t cls = 0;
+    for (size_t i = 0; i < BYTE_VALUES; i++)
+    {
+      SymbolT symbol = static_cast<SymbolT>(SymbolRanges<SymbolT>::min() + i);
+      while (cls < _starts.size() && _starts[cls] <= symbol)
+      {
+        cls++;
+      }
+      _byteClasses[static_cast<unsigned char>(symbol)] = cls;
+    }
+  }
+
+  void _index(std::false_type)
+  {}
+};
+
+template <typename SymbolT>
+const bool SymbolClasses<SymbolT>::DENSE;
+
+template <typename SymbolT>
+const size_t SymbolClasses<SymbolT>::BYTE_VALUES;
+
+#endif // SYMBOL_CLASSES_H
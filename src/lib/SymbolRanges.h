@@ -0,0 +1,223 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef SYMBOL_RANGES_H
+#define SYMBOL_RANGES_H
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Lexemes.h"
+
+// A set of symbols stored as sorted, disjoint and non-adjacent ranges, as
+// written in a bracket class such as [a-z0-9].
+template <typename SymbolT>
+class SymbolRanges
+{
+public:
+  typedef std::pair<SymbolT, SymbolT> Range;
+
+  static SymbolT min()
+  {
+    return std::numeric_limits<SymbolT>::min();
+  }
+
+  static SymbolT max()
+  {
+    return std::numeric_limits<SymbolT>::max();
+  }
+
+private:
+  std::vector<Range> _ranges;
+
+public:
+  SymbolRanges() = default;
+
+  SymbolRanges(SymbolT low, SymbolT high)
+  {
+    add(low, high);
+  }
+
+  // every symbol but the end of input
+  static SymbolRanges any()
+  {
+    return SymbolRanges().negated();
+  }
+
+  std::vector<Range> const& get() const
+  {
+    return _ranges;
+  }
+
+  bool empty() const
+  {
+    return _ranges.empty();
+  }
+
+  // number of symbols, which saturates for the wide types
+  size_t count() const
+  {
+    size_t result = 0;
+    for (auto const& range : _ranges)
+    {
+      size_t width = static_cast<size_t>(static_cast<long long>(range.second)
+        - static_cast<long long>(range.first)) + 1;
+      result = result + width < result ? std::numeric_limits<size_t>::max() : result + width;
+    }
+    return result;
+  }
+
+  bool contains(SymbolT symbol) const
+  {
+    for (auto const& range : _ranges)
+    {
+      if (symbol < range.first)
+      {
+        return false;
+      }
+      if (symbol <= range.second)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void add(SymbolT symbol)
+  {
+    add(symbol, symbol);
+  }
+
+  void add(SymbolT low, SymbolT high)
+  {
+    if (high < low)
+    {
+      return;
+    }
+    std::vector<Range> result;
+    bool inserted = false;
+    for (auto const& range : _ranges)
+    {
+      if (_before(range, low))
+      {
+        result.push_back(range);
+      }
+      else if (_before(Range(low, high), range.first))
+      {
+        if (!inserted)
+        {
+          result.emplace_back(low, high);
+          inserted = true;
+        }
+        result.push_back(range);
+      }
+      else
+      {
+        // overlapping or adjacent: merge into the new range
+        low = std::min(low, range.first);
+        high = std::max(high, range.second);
+      }
+    }
+    if (!inserted)
+    {
+      result.emplace_back(low, high);
+    }
+    _ranges.swap(result);
+  }
+
+  void add(SymbolRanges const& other)
+  {
+    for (auto const& range : other._ranges)
+    {
+      add(range.first, range.second);
+    }
+  }
+
+  // the complement, the end of input excepted
+  SymbolRanges negated() const
+  {
+    SymbolRanges result;
+    SymbolT next = min();
+    bool done = false;
+    for (auto const& range : _ranges)
+    {
+      if (range.first > next)
+      {
+        result.add(next, static_cast<SymbolT>(range.first - 1));
+      }
+      if (range.second == max())
+      {
+        done = true;
+        break;
+      }
+      next = static_cast<SymbolT>(range.second + 1);
+    }
+    if (!done)
+    {
+      result.add(next, max());
+    }
+    result._remove(Lexemes<SymbolT>::END);
+    return result;
+  }
+
+  bool operator==(SymbolRanges const& other) const
+  {
+    return _ranges == other._ranges;
+  }
+
+  bool operator<(SymbolRanges const& other) const
+  {
+    return _ranges < other._ranges;
+  }
+
+private:
+  // true if 'range' ends before 'symbol', without touching it
+  static bool _before(Range const& range, SymbolT symbol)
+  {
+    return range.second < symbol && static_cast<SymbolT>(range.second + 1) != symbol;
+  }
+
+  void _remove(SymbolT symbol)
+  {
+    std::vector<Range> result;
+    for (auto const& range : _ranges)
+    {
+      if (symbol < range.first || range.second < symbol)
+      {
+        result.push_back(range);
+        continue;
+      }
+      if (range.first < symbol)
+      {
+        result.emplace_back(range.first, static_cast<SymbolT>(symbol - 1));
+      }
+      if (symbol < range.second)
+      {
+        result.emplace_back(static_cast<SymbolT>(symbol + 1), range.second);
+      }
+    }
+    _ranges.swap(result);
+  }
+};
+
+#endif // SYMBOL_RANGES_H
@@ -0,0 +1,389 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TAGGED_DFA_H
+#define TAGGED_DFA_H
+
+#include <limits>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "PikeVM.h"
+#include "SymbolClasses.h"
+#include "Span.h"
+
+// Extracts the capture groups in a single deterministic pass, for the
+// patterns which are not one-pass (see OnePassDFA): a tagged DFA after
+// Laurikari and Trofimovich, built from the PikeVM program. A state is the
+// ordered list of the threads the PikeVM would run, highest priority first,
+// and thread i keeps the capture slots of its groups (the tags) in the
+// registers [i * tags, (i + 1) * tags). Each transition carries the register
+// operations which turn the registers of a state into the ones of the next:
+// copy a register from the parent thread, or set it to the current position.
+// They are ordered so that they run in place. The captures are those of the
+// PikeVM.
+template <typename SymbolT>
+class TaggedDFA
+{
+private:
+  typedef PikeVM<SymbolT> _VM;
+  typedef typename _VM::Instruction _Instruction;
+
+  static const unsigned _NONE = std::numeric_limits<unsigned>::max();
+
+  // sources of a register operation besides the registers
+  static const unsigned _POSITION = _NONE - 1;
+  static const unsigned _CLEAR = _NONE - 2;
+  static const unsigned _TEMPORARY = _NONE / 2;
+
+  struct _Operation
+  {
+    unsigned target;
+    unsigned source;
+  };
+
+  struct _Transition
+  {
+    unsigned next = _NONE;
+    unsigned first = 0; // operations [first, last)
+    unsigned last = 0;
+  };
+
+  // a thread reached without reading, and the tags set on the way
+  struct _Item
+  {
+    unsigned pc;
+    unsigned parent;
+    std::vector<bool> saved;
+  };
+
+  bool _built = false;
+  unsigned _tagCount = 0;
+  unsigned _registerCount = 0;
+  SymbolClasses<SymbolT> _classes;
+  std::vector<unsigned> _matchThread; // per state, _NONE if not accepting
+  std::vector<_Transition> _transitions; // state * classes + class
+  std::vector<_Operation> _operations;
+  unsigned _startOperations = 0; // [0, _startOperations)
+
+public:
+  TaggedDFA() = default;
+
+  // gives up beyond 'maxStates' states (0 for no limit)
+  TaggedDFA(_VM const& vm, size_t maxStates) :
+    _tagCount(2 * vm.groupCount())
+  {
+    _built = _build(vm, maxStates);
+    if (!_built)
+    {
+      _matchThread.clear();
+      _transitions.clear();
+      _operations.clear();
+    }
+  }
+
+  bool isBuilt() const
+  {
+    return _built;
+  }
+
+  size_t stateCount() const
+  {
+    return _matchThread.size();
+  }
+
+  // same contract as PikeVM::match()
+  bool match(SymbolT const* input, Span const& span, std::vector<Span>& groups) const
+  {
+    std::vector<size_t> registers(_registerCount);
+    _run(0, _startOperations, registers, span.begin);
+
+    unsigned state = 0;
+    for (size_t position = span.begin; position < span.end; position++)
+    {
+      _Transition const& transition =
+        _transitions[state * _classes.size() + _classes.classOf(input[position])];
+      if (transition.next == _NONE)
+      {
+        return false;
+      }
+      _run(transition.first, transition.last, registers, position + 1);
+      state = transition.next;
+    }
+    unsigned thread = _matchThread[state];
+    if (thread == _NONE)
+    {
+      return false;
+    }
+
+    groups.assign(_tagCount / 2 + 1, Span::unset());
+    groups[0] = span;
+    for (unsigned i = 1; i < groups.size(); i++)
+    {
+      size_t begin = registers[thread * _tagCount + 2 * i - 2];
+      size_t end = registers[thread * _tagCount + 2 * i - 1];
+      if (begin != static_cast<size_t>(-1) && end != static_cast<size_t>(-1))
+      {
+        groups[i].begin = begin;
+        groups[i].end = end;
+      }
+    }
+    return true;
+  }
+
+private:
+  void _run(unsigned first, unsigned last, std::vector<size_t>& registers,
+    size_t position) const
+  {
+    for (unsigned i = first; i < last; i++)
+    {
+      _Operation const& operation = _operations[i];
+      registers[operation.target] = operation.source == _POSITION ? position
+        : operation.source == _CLEAR ? static_cast<size_t>(-1)
+        : registers[operation.source];
+    }
+  }
+
+  // Follows the SPLIT and SAVE instructions from 'pc' in the order of the
+  // PikeVM, and appends the threads reached first to 'items'.
+  void _closure(std::vector<_Instruction> const& program, unsigned pc,
+    unsigned parent, std::vector<bool>& visited, std::vector<_Item>& items) const
+  {
+    std::vector<std::pair<unsigned, std::vector<bool>>> stack {
+      { pc, std::vector<bool>(_tagCount, false) }
+    };
+    while (!stack.empty())
+    {
+      auto top = std::move(stack.back());
+      stack.pop_back();
+      if (visited[top.first])
+      {
+        continue;
+      }
+      visited[top.first] = true;
+
+      _Instruction const& instruction = program[top.first];
+      switch (instruction.op)
+      {
+        case _VM::SPLIT:
+          stack.emplace_back(instruction.alternative, top.second);
+          stack.emplace_back(instruction.next, std::move(top.second));
+          break;
+
+        case _VM::SAVE:
+          top.second[instruction.slot - 2] = true;
+          stack.emplace_back(instruction.next, std::move(top.second));
+          break;
+
+        default:
+          items.push_back(_Item { top.first, parent, std::move(top.second) });
+          break;
+      }
+    }
+  }
+
+  // Orders the copies 'moves' (target, source) so that each register is
+  // read before it is overwritten; a cycle goes through a temporary.
+  void _sequence(std::vector<_Operation> moves, unsigned& temporaries)
+  {
+    unsigned temporary = _TEMPORARY;
+    while (!moves.empty())
+    {
+      bool progress = false;
+      for (size_t i = 0; i < moves.size(); i++)
+      {
+        bool read = false;
+        for (size_t j = 0; j < moves.size() && !read; j++)
+        {
+          read = j != i && moves[j].source == moves[i].target;
+        }
+        if (!read)
+        {
+          _operations.push_back(moves[i]);
+          moves.erase(moves.begin() + i);
+          progress = true;
+          break;
+        }
+      }
+      if (!progress)
+      {
+        unsigned saved = moves.front().target;
+        _operations.push_back(_Operation { temporary, saved });
+        for (auto& move : moves)
+        {
+          if (move.source == saved)
+          {
+            move.source = temporary;
+          }
+        }
+        temporary++;
+      }
+    }
+    temporaries = std::max(temporaries, temporary - _TEMPORARY);
+  }
+
+  // the operations which give the registers of 'items'
+  void _emitOperations(std::vector<_Item> const& items, unsigned& temporaries)
+  {
+    std::vector<_Operation> moves;
+    for (unsigned i = 0; i < items.size(); i++)
+    {
+      for (unsigned tag = 0; tag < _tagCount; tag++)
+      {
+        unsigned target = i * _tagCount + tag;
+        unsigned source = items[i].saved[tag] ? _POSITION
+          : items[i].parent == _NONE ? _CLEAR
+          : items[i].parent * _tagCount + tag;
+        if (source != target)
+        {
+          moves.push_back(_Operation { target, source });
+        }
+      }
+    }
+    _sequence(moves, temporaries);
+  }
+
+  bool _build(_VM const& vm, size_t maxStates)
+  {
+    auto const& program = vm.getProgram();
+
+    std::set<SymbolT> starts;
+    for (auto const& instruction : program)
+    {
+      if (instruction.op == _VM::SYMBOL)
+      {
+        SymbolClasses<SymbolT>::split(starts, instruction.symbol, instruction.symbol);
+      }
+      else if (instruction.op == _VM::CLASS)
+      {
+        SymbolClasses<SymbolT>::split(starts, instruction.ranges);
+      }
+    }
+    _classes = SymbolClasses<SymbolT>(starts);
+
+    unsigned temporaries = 0;
+    size_t maxThreads = 0;
+    std::vector<bool> visited(program.size(), false);
+
+    std::vector<_Item> items;
+    _closure(program, vm.getStart(), _NONE, visited, items);
+    _emitOperations(items, temporaries);
+    _startOperations = static_cast<unsigned>(_operations.size());
+
+    std::vector<std::vector<unsigned>> states;
+    std::map<std::vector<unsigned>, unsigned> index;
+    auto addState = [&] (std::vector<_Item> const& items) {
+      std::vector<unsigned> pcs;
+      for (auto const& item : items)
+      {
+        pcs.push_back(item.pc);
+      }
+      auto it = index.find(pcs);
+      if (it != index.end())
+      {
+        return it->second;
+      }
+      unsigned id = static_cast<unsigned>(states.size());
+      index.emplace(pcs, id);
+      states.push_back(pcs);
+      maxThreads = std::max(maxThreads, pcs.size());
+      return id;
+    };
+    addState(items);
+
+    for (unsigned id = 0; id < states.size(); id++)
+    {
+      if (maxStates != 0 && states.size() > maxStates)
+      {
+        return false;
+      }
+      std::vector<unsigned> const pcs = states[id];
+
+      _matchThread.push_back(_NONE);
+      for (unsigned i = 0; i < pcs.size(); i++)
+      {
+        if (program[pcs[i]].op == _VM::MATCH)
+        {
+          _matchThread.back() = i;
+          break;
+        }
+      }
+
+      _transitions.resize(states.size() * _classes.size());
+      for (size_t cls = 0; cls < _classes.size(); cls++)
+      {
+        SymbolT symbol = _classes.representative(cls);
+        items.clear();
+        visited.assign(program.size(), false);
+        for (unsigned i = 0; i < pcs.size(); i++)
+        {
+          if (program[pcs[i]].reads(symbol))
+          {
+            _closure(program, program[pcs[i]].next, i, visited, items);
+          }
+        }
+        if (items.empty())
+        {
+          continue;
+        }
+
+        _Transition transition;
+        transition.first = static_cast<unsigned>(_operations.size());
+        _emitOperations(items, temporaries);
+        transition.last = static_cast<unsigned>(_operations.size());
+        transition.next = addState(items);
+        _transitions.resize(states.size() * _classes.size());
+        _transitions[id * _classes.size() + cls] = transition;
+      }
+    }
+
+    // the temporaries go after the registers of the threads
+    unsigned base = static_cast<unsigned>(maxThreads * _tagCount);
+    for (auto& operation : _operations)
+    {
+      for (unsigned* reg : { &operation.target, &operation.source })
+      {
+        if (*reg >= _TEMPORARY && *reg < _CLEAR)
+        {
+          *reg = base + (*reg - _TEMPORARY);
+        }
+      }
+    }
+    _registerCount = base + temporaries;
+    return true;
+  }
+};
+
+template <typename SymbolT>
+const unsigned TaggedDFA<SymbolT>::_NONE;
+
+template <typename SymbolT>
+const unsigned TaggedDFA<SymbolT>::_POSITION;
+
+template <typename SymbolT>
+const unsigned TaggedDFA<SymbolT>::_CLEAR;
+
+template <typename SymbolT>
+const unsigned TaggedDFA<SymbolT>::_TEMPORARY;
+
+#endif // TAGGED_DFA_H
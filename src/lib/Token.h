@@ -22,9 +22,11 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <list>
+
+#include <string>
 
 #include "Lexemes.h"
+#include "SymbolRanges.h"
 
 template <typename SymbolT>
 class Token
@@ -40,18 +42,33 @@ public:
     OPTION,
     PLUS,
     END,
-    LAMBDA
+    LAMBDA,
+    CLASS,
+    GROUP // postfix only: its operand is the capture group getGroup()
   };
 
 private:
   Label _label;
   SymbolT _value;
+  SymbolRanges<SymbolT> _ranges; // CLASS only
+  unsigned _group = 0; // GROUP only
 
 public:
   Token(Label label, SymbolT value=Lexemes<SymbolT>::END) :
     _label(label), _value(value)
   {}
 
+  explicit Token(SymbolRanges<SymbolT> const& ranges) :
+    _label(CLASS), _value(Lexemes<SymbolT>::END), _ranges(ranges)
+  {}
+
+  static Token group(unsigned index)
+  {
+    Token token(GROUP);
+    token._group = index;
+    return token;
+  }
+
   Label getLabel() const
   {
     return _label;
@@ -62,6 +79,22 @@ public:
     return _value;
   }
 
+  SymbolRanges<SymbolT> const& getRanges() const
+  {
+    return _ranges;
+  }
+
+  unsigned getGroup() const
+  {
+    return _group;
+  }
+
+  // true for the tokens that stand for one symbol of input
+  bool isOperand() const
+  {
+    return _label == LAMBDA || _label == CLASS;
+  }
+
   std::string toString() const
   {
     switch (_label)
@@ -75,7 +108,10 @@ public:
       case CONCAT: return ".";
       case END: return "[END]";
       case LAMBDA: return Lexemes<SymbolT>::toString(_value);
+      case CLASS: return "[class]";
+      case GROUP: return "[group " + std::to_string(_group) + "]";
     }
+    return "";
   }
 };
 
@@ -0,0 +1,202 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#ifndef TOKENIZER_BASE_H
+#define TOKENIZER_BASE_H
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CompileOptions.h"
+#include "DFA.h"
+#include "DFABuilder.h"
+#include "Lexemes.h"
+#include "NFA.h"
+#include "NFABuilder.h"
+#include "ParsePattern.h"
+#include "Span.h"
+
+// A token of an input: the index of the pattern it matched, and where.
+struct TokenMatch
+{
+  size_t id = 0;
+  Span span;
+};
+
+// Splits inputs into tokens, the way a generated lexer does, from an
+// ordered list of token patterns. The patterns are compiled into a single
+// DFA whose acceptors are tagged with the first pattern they accept (see
+// DFABuilder). The input is scanned by maximal munch: a token is the
+// longest match from the end of the previous one and, when several patterns
+// match it, the first of the list wins. A token costs one pass of the DFA
+// over it, plus the symbols read past its end before the DFA dies, whatever
+// the number of patterns.
+//
+// The DFA is always built up front, so maxDFAStates only applies if
+// failOnDFAStates is set. A pattern that matches the empty string is
+// rejected, since it would never let the scan move on.
+template <typename SymbolT>
+class TokenizerBase
+{
+private:
+  typedef std::basic_string<SymbolT> _String;
+
+  CompileOptions _options;
+  size_t _patterns;
+  DFA<SymbolT> _dfa;
+
+public:
+  explicit TokenizerBase(std::vector<_String> const& patterns,
+    CompileOptions const& options=CompileOptions()) :
+    _options(options), _patterns(patterns.size())
+  {
+    _compile(patterns);
+  }
+
+  // the number of token patterns
+  size_t size() const
+  {
+    return _patterns;
+  }
+
+  size_t stateCount() const
+  {
+    return _dfa.size();
+  }
+
+  CompileOptions const& getOptions() const
+  {
+    return _options;
+  }
+
+  // the longest token that starts at 'position', false if none does
+  bool next(SymbolT const* input, size_t position, TokenMatch& token) const
+  {
+    DStateId const* table = _dfa.table();
+    DStateId current = _dfa.getInitial();
+    DStateId accepted = current;
+    size_t end = position;
+    for (size_t i = position; input[i] != Lexemes<SymbolT>::END; )
+    {
+      current = table[current + _dfa.columnOf(input[i])];
+      i++;
+      if (_dfa.isDead(current))
+      {
+        break;
+      }
+      if (_dfa.isAcceptor(current))
+      {
+        accepted = current;
+        end = i;
+      }
+    }
+    if (end == position)
+    {
+      return false;
+    }
+    token.id = _dfa.getTag(accepted);
+    token.span.begin = position;
+    token.span.end = end;
+    return true;
+  }
+
+  // Writes the tokens of the input to 'out', in order, and returns how many
+  // symbols they cover: the length of the input, or the position of the
+  // first symbol where no token starts.
+  template <typename OutputIterator>
+  size_t tokenize(SymbolT const* input, OutputIterator out) const
+  {
+    size_t position = 0;
+    TokenMatch token;
+    while (input[position] != Lexemes<SymbolT>::END
+      && next(input, position, token))
+    {
+      *out++ = token;
+      position = token.span.end;
+    }
+    return position;
+  }
+
+  // same; 'covered', if any, receives what the tokens cover
+  std::vector<TokenMatch> tokenize(SymbolT const* input,
+    size_t* covered=nullptr) const
+  {
+    std::vector<TokenMatch> tokens;
+    size_t position = tokenize(input, std::back_inserter(tokens));
+    if (covered != nullptr)
+    {
+      *covered = position;
+    }
+    return tokens;
+  }
+
+  std::vector<TokenMatch> tokenize(_String const& input,
+    size_t* covered=nullptr) const
+  {
+    return tokenize(input.c_str(), covered);
+  }
+
+private:
+  void _compile(std::vector<_String> const& patterns)
+  {
+    if (patterns.empty())
+    {
+      throw std::invalid_argument("no token pattern");
+    }
+
+    CompileOptions limits(_options);
+    if (!limits.failOnDFAStates)
+    {
+      limits.maxDFAStates = 0;
+    }
+    CompileBudget budget(limits);
+
+    // the initial state leads to the automaton of each pattern, and each
+    // one to an acceptor of its own, tagged with its index
+    NFA<SymbolT> nfa;
+    std::vector<unsigned> tags;
+    for (size_t i = 0; i < patterns.size(); i++)
+    {
+      NFA<SymbolT> token;
+      NFABuilder<SymbolT> builder(parsePattern(patterns[i].c_str(), _options),
+        token, &budget);
+      StateId acceptor = nfa.addState();
+      nfa.insert(token, nfa.getInitial(), acceptor);
+      nfa.setAcceptor(acceptor);
+      budget.checkNFAStates(nfa.size());
+      tags.resize(nfa.size(), 0);
+      tags[acceptor] = static_cast<unsigned>(i);
+    }
+
+    DFABuilder<SymbolT> builder(nfa, _dfa, &budget, &tags);
+    if (_dfa.isAcceptor(_dfa.getInitial()))
+    {
+      throw std::invalid_argument("the token pattern "
+        + std::to_string(_dfa.getTag(_dfa.getInitial()))
+        + " matches the empty string");
+    }
+  }
+};
+
+#endif // TOKENIZER_BASE_H
@@ -0,0 +1,313 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2014 Barthelemy Delemotte
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+// the Software, and to permit persons to whom the Software is furnished to do so,
+// subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef UTF8_CONVERTOR_H
+#define UTF8_CONVERTOR_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include "Token.h"
+#include "SymbolRanges.h"
+#include "Lexer.h"
+#include "NPIConvertor.h"
+
+// Turns a postfix token list over code points (as produced for a wchar_t
+// pattern) into a postfix token list over UTF-8 bytes, so that the automata
+// run directly on UTF-8 input. A code point becomes the concatenation of its
+// bytes and a class becomes an alternation of byte-range sequences, e.g.
+// [\u0080-\u07FF] becomes [\xC2-\xDF][\x80-\xBF].
+class Utf8Convertor
+{
+public:
+  typedef ::Token<char> Token;
+  typedef ::Token<wchar_t> CodePointToken;
+
+  static const wchar_t MAX_CODE_POINT = 0x10FFFF;
+
+private:
+  typedef std::pair<unsigned char, unsigned char> _ByteRange;
+  typedef std::vector<_ByteRange> _Sequence;
+
+  static const unsigned long _SURROGATE_LOW = 0xD800;
+  static const unsigned long _SURROGATE_HIGH = 0xDFFF;
+
+  std::vector<CodePointToken> const& _input;
+  std::vector<Token>& _output;
+
+public:
+  Utf8Convertor(std::vector<CodePointToken> const& input, std::vector<Token>& output) :
+    _input(input), _output(output)
+  {
+    _convert();
+  }
+
+  // decodes, lexes and converts a UTF-8 pattern, with GROUP tokens if
+  // 'groups' (see NPIConvertor)
+  static std::vector<Token> postfix(char const* expr, bool groups=false)
+  {
+    std::wstring pattern = decode(expr);
+    std::vector<CodePointToken> tokens;
+    std::vector<CodePointToken> npi;
+    std::vector<Token> output;
+    Lexer<wchar_t> lexer(pattern.c_str(), tokens);
+    NPIConvertor<wchar_t> convertor(tokens, npi, groups);
+    Utf8Convertor utf8Convertor(npi, output);
+    return output;
+  }
+
+  // throws std::invalid_argument on malformed UTF-8 (overlong forms and
+  // surrogates included).
+  static std::wstring decode(char const* str)
+  {
+    std::wstring result;
+    auto bytes = reinterpret_cast<unsigned char const*>(str);
+    while (*bytes != 0)
+    {
+      unsigned long cp = *bytes++;
+      size_t length = cp < 0x80 ? 0 : cp < 0xC2 ? 4 : cp < 0xE0 ? 1 : cp < 0xF0 ? 2 : cp < 0xF5 ? 3 : 4;
+      if (length == 4)
+      {
+        throw std::invalid_argument("invalid UTF-8");
+      }
+      if (length > 0)
+      {
+        cp &= 0x3F >> length;
+      }
+      for (size_t i = 0; i < length; i++, bytes++)
+      {
+        if ((*bytes & 0xC0) != 0x80)
+        {
+          throw std::invalid_argument("invalid UTF-8");
+        }
+        cp = (cp << 6) | (*bytes & 0x3F);
+      }
+      if ((length == 2 && cp < 0x800) || (length == 3 && cp < 0x10000)
+        || cp > MAX_CODE_POINT || (cp >= _SURROGATE_LOW && cp <= _SURROGATE_HIGH))
+      {
+        throw std::invalid_argument("invalid UTF-8");
+      }
+      result += static_cast<wchar_t>(cp);
+    }
+    return result;
+  }
+
+  static std::string encode(unsigned long cp)
+  {
+    std::string result;
+    if (cp < 0x80)
+    {
+      result += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+      result += static_cast<char>(0xC0 | (cp >> 6));
+      result += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+      result += static_cast<char>(0xE0 | (cp >> 12));
+      result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      result += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+      result += static_cast<char>(0xF0 | (cp >> 18));
+      result += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      result += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return result;
+  }
+
+private:
+  void _convert()
+  {
+    for (auto const& token : _input)
+    {
+      switch (token.getLabel())
+      {
+        case CodePointToken::LAMBDA:
+          _outputCodePoint(token.getValue());
+          break;
+
+        case CodePointToken::CLASS:
+          _outputClass(token.getRanges());
+          break;
+
+        case CodePointToken::GROUP:
+          _output.push_back(Token::group(token.getGroup()));
+          break;
+
+        default:
+          _output.push_back(Token(static_cast<Token::Label>(token.getLabel())));
+          break;
+      }
+    }
+  }
+
+  void _outputCodePoint(wchar_t cp)
+  {
+    if (cp < 0 || cp > MAX_CODE_POINT)
+    {
+      throw std::invalid_argument("invalid code point");
+    }
+    std::string bytes = encode(cp);
+    _output.push_back(Token(Token::LAMBDA, bytes[0]));
+    for (size_t i = 1; i < bytes.size(); i++)
+    {
+      _output.push_back(Token(Token::LAMBDA, bytes[i]));
+      _output.push_back(Token(Token::CONCAT));
+    }
+  }
+
+  void _outputClass(SymbolRanges<wchar_t> const& ranges)
+  {
+    std::vector<_Sequence> sequences;
+    SymbolRanges<wchar_t> valid = _validRanges(ranges);
+    for (auto const& range : valid.get())
+    {
+      _split(range.first, range.second, sequences);
+    }
+
+    if (sequences.empty())
+    {
+      _output.push_back(Token(SymbolRanges<char>()));
+      return;
+    }
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+      _outputSequence(sequences[i]);
+      if (i > 0)
+      {
+        _output.push_back(Token(Token::OR));
+      }
+    }
+  }
+
+  void _outputSequence(_Sequence const& sequence)
+  {
+    for (size_t i = 0; i < sequence.size(); i++)
+    {
+      char low = static_cast<char>(sequence[i].first);
+      char high = static_cast<char>(sequence[i].second);
+      if (low == high)
+      {
+        _output.push_back(Token(Token::LAMBDA, low));
+      }
+      else
+      {
+        _output.push_back(Token(SymbolRanges<char>(low, high)));
+      }
+      if (i > 0)
+      {
+        _output.push_back(Token(Token::CONCAT));
+      }
+    }
+  }
+
+  // the ranges clipped to the valid code points, surrogates excluded
+  static SymbolRanges<wchar_t> _validRanges(SymbolRanges<wchar_t> const& ranges)
+  {
+    SymbolRanges<wchar_t> valid;
+    for (auto const& range : ranges.get())
+    {
+      long low = std::max<long>(range.first, 1);
+      long high = std::min<long>(range.second, MAX_CODE_POINT);
+      if (low <= high)
+      {
+        valid.add(static_cast<wchar_t>(low), static_cast<wchar_t>(high));
+      }
+    }
+    SymbolRanges<wchar_t> result;
+    for (auto const& range : valid.get())
+    {
+      if (range.second < static_cast<wchar_t>(_SURROGATE_LOW)
+        || range.first > static_cast<wchar_t>(_SURROGATE_HIGH))
+      {
+        result.add(range.first, range.second);
+        continue;
+      }
+      if (range.first < static_cast<wchar_t>(_SURROGATE_LOW))
+      {
+        result.add(range.first, _SURROGATE_LOW - 1);
+      }
+      if (range.second > static_cast<wchar_t>(_SURROGATE_HIGH))
+      {
+        result.add(_SURROGATE_HIGH + 1, range.second);
+      }
+    }
+    return result;
+  }
+
+  // Splits [low, high] until each part is the cartesian product of byte
+  // ranges: first at the boundaries of the encoding lengths, then where a
+  // continuation byte does not cover its whole range.
+  static void _split(unsigned long low, unsigned long high,
+    std::vector<_Sequence>& sequences)
+  {
+    static const unsigned long lengthLimits[] = { 0x7F, 0x7FF, 0xFFFF };
+    for (auto limit : lengthLimits)
+    {
+      if (low <= limit && high > limit)
+      {
+        _split(low, limit, sequences);
+        _split(limit + 1, high, sequences);
+        return;
+      }
+    }
+
+    for (unsigned i = 1; i < 4 && high > 0x7F; i++)
+    {
+      unsigned long mask = (1ul << (6 * i)) - 1;
+      if ((low & ~mask) != (high & ~mask))
+      {
+        if ((low & mask) != 0)
+        {
+          _split(low, low | mask, sequences);
+          _split((low | mask) + 1, high, sequences);
+          return;
+        }
+        if ((high & mask) != mask)
+        {
+          _split(low, (high & ~mask) - 1, sequences);
+          _split(high & ~mask, high, sequences);
+          return;
+        }
+      }
+    }
+
+    std::string lowBytes = encode(low);
+    std::string highBytes = encode(high);
+    _Sequence sequence;
+    for (size_t i = 0; i < lowBytes.size(); i++)
+    {
+      sequence.emplace_back(static_cast<unsigned char>(lowBytes[i]),
+        static_cast<unsigned char>(highBytes[i]));
+    }
+    sequences.push_back(sequence);
+  }
+};
+
+#endif // UTF8_CONVERTOR_H
@@ -22,12 +22,30 @@
 #include <iostream>
 #include <cassert>
 #include <list>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <random>
 
 #include "NFA.h"
 #include "Regex.h"
 #include "Lexer.h"
 #include "NPIConvertor.h"
 #include "Token.h"
+#include "SharedLazyDFA.h"
+#include "NFABuilder.h"
+#include "NFASimulator.h"
+#include "AhoCorasick.h"
+#include "Utf8Convertor.h"
+#include "DFABuilder.h"
+#include "SymbolClasses.h"
+#include "Optimizer.h"
+#include "PikeVM.h"
+#include "OnePassDFA.h"
+#include "TaggedDFA.h"
+#include "BoundedBacktracker.h"
 
 // this function doesn't free data.
 void testNFA()
@@ -148,7 +166,7 @@ void testNFA()
 
 typedef Token<char> TokenC;
 
-static bool compareTokenCList(std::list<TokenC>const& l1, std::list<TokenC>const& l2)
+static bool compareTokenCList(std::vector<TokenC>const& l1, std::vector<TokenC>const& l2)
 {
   if (l1.size() != l2.size())
   {
@@ -166,34 +184,33 @@ static bool compareTokenCList(std::list<TokenC>const& l1, std::list<TokenC>const
   return true;
 }
 
-static void showTokenList(std::list<TokenC> const& l)
-{
-  for (auto token : l)
-  {
-    std::cout << token.toString() << " ";
-  }
-  std::cout << std::endl;
-}
-
 void testLexer()
 {
   std::cout << "Testing Lexer ..." << std::endl;
 
   Lexer<char> lexer1("to");
-  std::list<TokenC> l1 {
+  std::vector<TokenC> l1 {
     TokenC(TokenC::LAMBDA), TokenC(TokenC::CONCAT),
     TokenC(TokenC::LAMBDA), TokenC(TokenC::END)
   };
   assert(compareTokenCList(lexer1.collect(), l1));
 
   Lexer<char> lexer2("a(b|c)*d");
-  std::list<TokenC> l2 {
+  std::vector<TokenC> l2 {
     TokenC(TokenC::LAMBDA), TokenC(TokenC::CONCAT), TokenC(TokenC::LEFT_PARENTH),
     TokenC(TokenC::LAMBDA), TokenC(TokenC::OR), TokenC(TokenC::LAMBDA),
     TokenC(TokenC::RIGHT_PARENTH), TokenC(TokenC::STAR), TokenC(TokenC::CONCAT),
     TokenC(TokenC::LAMBDA), TokenC(TokenC::END)
   };
   assert(compareTokenCList(lexer2.collect(), l2));
+
+  Lexer<char> lexer3("[a-c]\\.");
+  std::vector<TokenC> l3 = lexer3.collect();
+  assert(l3.size() == 4 && l3.front().getLabel() == TokenC::CLASS);
+  assert(l3.front().getRanges() == SymbolRanges<char>('a', 'c'));
+  assert((++l3.begin())->getLabel() == TokenC::CONCAT);
+  assert((++++l3.begin())->getLabel() == TokenC::LAMBDA);
+  assert((++++l3.begin())->getValue() == '.');
 }
 
 void testNPIConvertor()
@@ -204,7 +221,7 @@ void testNPIConvertor()
 
   NPIConvertor<char> npiConvertor(lexer.collect());
 
-  std::list<TokenC> l {
+  std::vector<TokenC> l {
     TokenC(TokenC::LAMBDA), TokenC(TokenC::STAR), TokenC(TokenC::LAMBDA),
     TokenC(TokenC::LAMBDA), TokenC(TokenC::LAMBDA), TokenC(TokenC::LAMBDA),
     TokenC(TokenC::OR), TokenC(TokenC::CONCAT), TokenC(TokenC::STAR),
@@ -215,12 +232,1703 @@ void testNPIConvertor()
   assert(compareTokenCList(npiConvertor.collect(), l));
 }
 
-int main(int argc, char const *argv[])
+void testLazyDFA()
+{
+  std::cout << "Testing LazyDFA ..." << std::endl;
+
+  // the subset construction of this one has 2^7 states.
+  char const* expr = "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)";
+  NFA<char> nfa;
+  NFABuilder<char> builder(expr, nfa);
+
+  std::string input;
+  unsigned seed = 42;
+  for (int i = 0; i < 2000; i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    input += (seed >> 16) & 1 ? 'a' : 'b';
+  }
+
+  NFASimulator<char> simulator;
+  LazyDFAStats stats;
+  std::vector<bool> universal = nfa.universalStates();
+
+  LazyDFACache<char> large(nfa, universal, 1 << 24);
+  for (size_t len = 0; len < input.size(); len += 97)
+  {
+    std::string prefix = input.substr(0, len);
+    assert(large.simulate<NullCounters>(prefix.c_str(), nullptr, &stats)
+      == simulator.simulate(nfa, prefix.c_str()));
+  }
+  assert(stats.flushes == 0 && stats.fallbacks == 0);
+
+  // a tiny budget forces flushes, then the NFA fallback.
+  LazyDFACache<char> tiny(nfa, universal, 2048, 2);
+  for (size_t len = 0; len < input.size(); len += 97)
+  {
+    std::string prefix = input.substr(0, len);
+    assert(tiny.simulate<NullCounters>(prefix.c_str(), nullptr, &stats)
+      == simulator.simulate(nfa, prefix.c_str()));
+    assert(tiny.memoryUsage() <= 2048 + 512);
+  }
+  assert(stats.flushes > 0);
+  assert(stats.fallbacks > 0);
+  // once it thrashes, the scans that find it full fall back without flushing
+  size_t flushed = stats.flushes;
+  for (int i = 0; i < 100; i++)
+  {
+    assert(tiny.simulate<NullCounters>(input.c_str(), nullptr, &stats)
+      == simulator.simulate(nfa, input.c_str()));
+  }
+  assert(stats.flushes == flushed);
+
+  // flushes under readers: the threads swap the cache while the others scan
+  LazyDFACache<char> swapped(nfa, universal, 2048, 1 << 20);
+  LazyDFAStats swappedStats;
+  std::vector<std::thread> swappers;
+  std::atomic<size_t> wrong(0);
+  for (unsigned t = 0; t < 4; t++)
+  {
+    swappers.emplace_back([&, t] () {
+      NFASimulator<char> local;
+      for (size_t len = t; len < input.size(); len += 89)
+      {
+        std::string prefix = input.substr(0, len);
+        if (swapped.simulate<NullCounters>(prefix.c_str(), nullptr, &swappedStats)
+          != local.simulate(nfa, prefix.c_str()))
+        {
+          wrong++;
+        }
+      }
+    });
+  }
+  for (auto& thread : swappers)
+  {
+    thread.join();
+  }
+  assert(wrong == 0);
+  assert(swappedStats.flushes > 0 && swappedStats.fallbacks == 0);
+
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  Regex re(expr, lazy);
+  re.setCacheBudget(1024);
+  assert(re.match(input.c_str()) == simulator.simulate(nfa, input.c_str()));
+  assert(re.cacheFlushes() > 0 && re.cacheFallbacks() > 0);
+  assert(re.getStats().cacheFlushes == re.cacheFlushes());
+  assert(re.match("bbbaaaaaaa"));
+  assert(!re.match("bbbbaaaaaa"));
+
+  // the threads warm one cache together
+  SharedLazyDFA<char> shared(nfa, universal, 1 << 24);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> mismatches(0);
+  for (unsigned t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&, t] () {
+      NFASimulator<char> local;
+      for (size_t len = t; len < input.size(); len += 37)
+      {
+        std::string prefix = input.substr(0, len);
+        if (shared.simulate<NullCounters>(prefix.c_str())
+          != local.simulate(nfa, prefix.c_str()))
+        {
+          mismatches++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  assert(mismatches == 0);
+  assert(shared.stateCount() >= 1 << 7);
+
+  // a tiny one alone hands over to the NFA once its budget is spent, and
+  // stays within it
+  SharedLazyDFA<char> small(nfa, universal, 2048);
+  LazyDFAStats smallStats;
+  for (size_t len = 0; len < input.size(); len += 97)
+  {
+    std::string prefix = input.substr(0, len);
+    assert(small.simulate<NullCounters>(prefix.c_str(), nullptr, &smallStats)
+      == simulator.simulate(nfa, prefix.c_str()));
+  }
+  assert(smallStats.fallbacks > 0 && small.memoryUsage() <= 2048);
+
+  // the copies of a regex share its cache
+  InstrumentedRegex warm(expr, lazy);
+  InstrumentedRegex copy(warm);
+  assert(warm.match(input.c_str()) == copy.match(input.c_str()));
+  assert(copy.getStats().cacheMisses == 0);
+}
+
+static std::string nestedPlus(int depth)
+{
+  std::string expr = "a";
+  for (int i = 0; i < depth; i++)
+  {
+    expr = "(" + expr + "+)";
+  }
+  return expr;
+}
+
+static std::string alternations(int count)
+{
+  std::string expr;
+  for (int i = 0; i < count; i++)
+  {
+    expr += "((ab)|(cd))";
+  }
+  return expr;
+}
+
+void testCompileOptions()
+{
+  std::cout << "Testing CompileOptions ..." << std::endl;
+
+  CompileOptions nfaCap;
+  nfaCap.maxNFAStates = 1000;
+  try
+  {
+    Regex re(alternations(200), nfaCap);
+    assert(false);
+  }
+  catch (ComplexityError const& e)
+  {
+    assert(e.getLimit() == ComplexityError::NFA_STATES);
+  }
+  Regex small(alternations(3), nfaCap);
+  assert(small.match("abcdab"));
+
+  // a nested repetition is neither copied nor kept
+  Regex nested(nestedPlus(24), nfaCap);
+  assert(nested.match("aaa") && !nested.match(""));
+
+  CompileOptions timeCap;
+  timeCap.maxCompileTime = std::chrono::milliseconds(1);
+  try
+  {
+    Regex re(alternations(20000), timeCap);
+    assert(false);
+  }
+  catch (ComplexityError const& e)
+  {
+    assert(e.getLimit() == ComplexityError::COMPILE_TIME);
+  }
+
+  char const* expr = "(a|b)*a(a|b)(a|b)(a|b)(a|b)";
+  CompileOptions dfaCap;
+  dfaCap.engine = CompileOptions::EAGER_DFA;
+  dfaCap.maxDFAStates = 8;
+  Regex degraded(expr, dfaCap);
+  assert(degraded.getEngine() == CompileOptions::LAZY_DFA);
+  assert(degraded.match("abbabbbb"));
+  assert(!degraded.match("abbbbbb"));
+
+  dfaCap.failOnDFAStates = true;
+  try
+  {
+    Regex re(expr, dfaCap);
+    assert(false);
+  }
+  catch (ComplexityError const& e)
+  {
+    assert(e.getLimit() == ComplexityError::DFA_STATES);
+  }
+
+  CompileOptions dfa;
+  dfa.engine = CompileOptions::EAGER_DFA;
+  Regex eager(expr, dfa);
+  assert(eager.getEngine() == CompileOptions::EAGER_DFA);
+  assert(eager.match("abbabbbb"));
+  assert(!eager.match("abbbbbb"));
+  assert(!eager.match("abbacbbb"));
+}
+
+// checks the chosen engine against the NFA on every string of {a, b, c}
+// up to 6 symbols, and its searches against those of the lazy DFA.
+static void checkEngine(char const* expr, CompileOptions::Engine engine)
+{
+  Regex re(expr);
+  assert(re.getEngine() == engine);
+  assert(!re.explain().empty());
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  Regex searcher(expr, lazy);
+
+  NFA<char> nfa;
+  NFABuilder<char> builder(expr, nfa);
+  NFASimulator<char> simulator;
+
+  std::list<std::string> inputs { "" };
+  for (auto const& input : inputs)
+  {
+    assert(re.match(input.c_str()) == simulator.simulate(nfa, input.c_str()));
+    Span span;
+    Span expected;
+    bool found = re.search(input.c_str(), span);
+    assert(found == searcher.search(input.c_str(), expected));
+    assert(!found || span == expected);
+    if (input.size() < 6)
+    {
+      for (char c : std::string("abc"))
+      {
+        inputs.push_back(input + c);
+      }
+    }
+  }
+}
+
+void testPlanner()
+{
+  std::cout << "Testing Planner ..." << std::endl;
+
+  checkEngine("", CompileOptions::LITERAL);
+  checkEngine("abca", CompileOptions::LITERAL);
+  checkEngine("(ab)|(ba)|(cab)", CompileOptions::AHO_CORASICK);
+  checkEngine("(a|b)(a|c)?", CompileOptions::AHO_CORASICK);
+  checkEngine("(a|b)*c(a|b)", CompileOptions::BIT_PARALLEL);
+  checkEngine("((ab)+c?)*b", CompileOptions::BIT_PARALLEL);
+
+  std::string large;
+  for (int i = 0; i < 70; i++)
+  {
+    large += "(a|b)*";
+  }
+  checkEngine(large.c_str(), CompileOptions::EAGER_DFA);
+
+  // the prefilter rejects without running the engine
+  Regex prefiltered("(a|b)*cab+");
+  assert(prefiltered.explain().find("prefilter") != std::string::npos);
+  assert(prefiltered.match("abcabbb"));
+  assert(!prefiltered.match("abcbbb"));
+
+  CompileOptions literal;
+  literal.engine = CompileOptions::LITERAL;
+  try
+  {
+    Regex re("a*", literal);
+    assert(false);
+  }
+  catch (std::invalid_argument const&)
+  {
+  }
+
+  std::vector<std::string> words { "he", "she", "hers", "his" };
+  AhoCorasick<char> ac(words);
+  std::string text = "ushers";
+  char const* begin;
+  char const* end;
+  assert(ac.find(text.data(), text.data() + text.size(), begin, end));
+  assert(begin == text.data() + 1 && end == text.data() + 4);
+  assert(!ac.find(text.data(), text.data() + 2, begin, end));
+
+  // leftmost-longest, not the first occurrence to end
+  AhoCorasick<char> nested(std::vector<std::string> { "abcd", "bc", "c" });
+  text = "xabcdy";
+  assert(nested.find(text.data(), text.data() + text.size(), begin, end));
+  assert(begin == text.data() + 1 && end == text.data() + 5);
+  text = "xabcy";
+  assert(nested.find(text.data(), text.data() + text.size(), begin, end));
+  assert(begin == text.data() + 2 && end == text.data() + 4);
+}
+
+// a class pattern must give the same answers with every feasible engine.
+static void checkClasses(char const* expr,
+  std::vector<std::string> const& matching,
+  std::vector<std::string> const& mismatching)
+{
+  CompileOptions::Engine engines[] = {
+    CompileOptions::AUTO, CompileOptions::BIT_PARALLEL,
+    CompileOptions::EAGER_DFA, CompileOptions::LAZY_DFA
+  };
+  for (auto engine : engines)
+  {
+    CompileOptions options;
+    options.engine = engine;
+    Regex re(expr, options);
+    for (auto const& input : matching)
+    {
+      assert(re.match(input.c_str()));
+    }
+    for (auto const& input : mismatching)
+    {
+      assert(!re.match(input.c_str()));
+    }
+  }
+}
+
+void testClasses()
+{
+  std::cout << "Testing classes ..." << std::endl;
+
+  checkClasses("[a-z0-9]+", { "abc", "a1z9", "0" }, { "", "aBc", "a-b" });
+  checkClasses("[^abc]*", { "", "xyz", "ABC" }, { "xaz", "c" });
+  checkClasses("a.c", { "abc", "a.c", "a c" }, { "ac", "abbc" });
+  checkClasses("\\d+\\.\\d+", { "3.14", "0.0" }, { "3,14", "3.", ".5" });
+  checkClasses("[\\w-]+@[a-z]+", { "john-doe@mail", "a_1@b" }, { "a b@c", "@c" });
+  checkClasses("[]a]+", { "]", "a]a" }, { "b" });
+  checkClasses("[a-]\\**", { "a", "-**", "a*" }, { "b", "**" });
+  checkClasses("\\s\\S", { " a", "\tb" }, { "a ", "  " });
+  checkClasses("\\(\\)|\\.", { "()", "(." }, { "(", ")" });
+
+  char const* invalid[] = { "[abc", "\\", "[z-a]", "[a-\\d]" };
+  for (auto expr : invalid)
+  {
+    try
+    {
+      Regex re(expr);
+      assert(false);
+    }
+    catch (std::invalid_argument const&)
+    {
+    }
+  }
+
+  // a range is a single transition, however large it is
+  NFA<wchar_t> nfa;
+  NFABuilder<wchar_t> builder(L"[\u0400-\u04FF]", nfa);
+  StateId start = *nfa.epsilonTransitions(nfa.getInitial()).begin();
+  assert(nfa.symbolTransitions(start).size() == 1);
+  assert(nfa.transitions(start, L'\u04AA').size() == 1);
+
+  WRegex cyrillic(L"[\u0400-\u04FF]+ \\d");
+  assert(cyrillic.match(L"\u041f\u0440\u0438 7"));
+  assert(!cyrillic.match(L"abc 7"));
+
+  // a small class still makes a literal set
+  Regex small("[ab]c");
+  assert(small.getEngine() == CompileOptions::AHO_CORASICK);
+  assert(small.match("bc") && !small.match("cc"));
+
+  // the byte table agrees with the search over the class starts
+  std::set<char> starts;
+  SymbolClasses<char>::split(starts, 'a', 'z');
+  SymbolClasses<char>::split(starts, '0', '9');
+  SymbolClasses<char>::split(starts, '\x80', '\xFF');
+  SymbolClasses<char> bytes(starts);
+  assert(SymbolClasses<char>::DENSE && !SymbolClasses<wchar_t>::DENSE);
+  for (int byte = -128; byte < 128; byte++)
+  {
+    char symbol = static_cast<char>(byte);
+    size_t cls = static_cast<size_t>(std::distance(starts.begin(),
+      std::upper_bound(starts.begin(), starts.end(), symbol)));
+    assert(bytes.classOf(symbol) == cls);
+    assert(bytes.byteClasses()[static_cast<unsigned char>(symbol)] == cls);
+  }
+  std::set<wchar_t> wideStarts;
+  SymbolClasses<wchar_t>::split(wideStarts, L'\u0400', L'\u04FF');
+  SymbolClasses<wchar_t> wide(wideStarts);
+  assert(wide.classOf(L'a') == 0 && wide.classOf(L'\u0401') == 1);
+  assert(wide.classOf(L'\u0500') == 2);
+}
+
+void testUtf8()
+{
+  std::cout << "Testing UTF-8 ..." << std::endl;
+
+  assert(Utf8Convertor::decode("a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80")
+    == std::wstring(L"a\u00E9\u20AC\U0001F600"));
+  char const* malformed[] = {
+    "\xC3", "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80"
+  };
+  for (auto str : malformed)
+  {
+    try
+    {
+      Utf8Convertor::decode(str);
+      assert(false);
+    }
+    catch (std::invalid_argument const&)
+    {
+    }
+  }
+  for (unsigned long cp : { 0x41ul, 0xE9ul, 0x7FFul, 0x800ul, 0xFFFFul, 0x10000ul, 0x10FFFFul })
+  {
+    assert(Utf8Convertor::decode(Utf8Convertor::encode(cp).c_str())
+      == std::wstring(1, static_cast<wchar_t>(cp)));
+  }
+
+  CompileOptions::Engine engines[] = {
+    CompileOptions::AUTO, CompileOptions::EAGER_DFA, CompileOptions::LAZY_DFA
+  };
+  for (auto engine : engines)
+  {
+    CompileOptions options;
+    options.utf8 = true;
+    options.engine = engine;
+
+    // '.' is a whole code point, of any length
+    Regex dots("a.b", options);
+    assert(dots.match("axb") && dots.match("a\xC3\xA9" "b")
+      && dots.match("a\xE2\x82\xAC" "b") && dots.match("a\xF0\x9F\x98\x80" "b"));
+    assert(!dots.match("a\xC3\xA9\xC3\xA9" "b") && !dots.match("a\xC3" "b")
+      && !dots.match("a\xED\xA0\x80" "b"));
+
+    // a multi-byte symbol is repeated as a whole
+    Regex repeated("\xC3\xA9+", options);
+    assert(repeated.match("\xC3\xA9\xC3\xA9") && !repeated.match("\xC3\xA9\xA9"));
+
+    // ranges across encoding lengths
+    Regex wide("[\xC2\x80-\xF0\x90\x80\x80]*", options);
+    assert(wide.match("\xC2\x80\xDF\xBF\xE0\xA0\x80\xEF\xBF\xBF\xF0\x90\x80\x80"));
+    assert(!wide.match("a") && !wide.match("\xF0\x90\x80\x81"));
+
+    Regex cyrillic("[\xD0\x80-\xD3\xBF]+ \\d", options);
+    assert(cyrillic.match("\xD0\x9F\xD1\x80\xD0\xB8 7"));
+    assert(!cyrillic.match("abc 7"));
+
+    Regex negated("[^\xC3\xA9]", options);
+    assert(negated.match("\xE2\x82\xAC") && negated.match("e"));
+    assert(!negated.match("\xC3\xA9") && !negated.match("\xC3"));
+  }
+
+  CompileOptions utf8;
+  utf8.utf8 = true;
+  try
+  {
+    Regex re("\xC3(", utf8);
+    assert(false);
+  }
+  catch (std::invalid_argument const&)
+  {
+  }
+  try
+  {
+    WRegex re(L"a", utf8);
+    assert(false);
+  }
+  catch (std::invalid_argument const&)
+  {
+  }
+}
+
+// checks the search against every substring of every string of {a, b, c}
+// up to 5 symbols, with the DFAs and with their NFA fallback.
+static void checkSearch(char const* expr)
+{
+  CompileOptions nfaOnly;
+  nfaOnly.maxDFAStates = 0;
+  Regex re(expr);
+  Regex slow(expr, nfaOnly);
+
+  NFA<char> nfa;
+  NFABuilder<char> builder(expr, nfa);
+  NFASimulator<char> simulator;
+
+  std::list<std::string> inputs { "" };
+  for (auto const& input : inputs)
+  {
+    bool found = false;
+    Span expected;
+    for (size_t begin = 0; begin <= input.size() && !found; begin++)
+    {
+      for (size_t end = input.size() + 1; end-- > begin; )
+      {
+        if (simulator.simulate(nfa, input.substr(begin, end - begin).c_str()))
+        {
+          found = true;
+          expected.begin = begin;
+          expected.end = end;
+          break;
+        }
+      }
+    }
+
+    Span span;
+    Span slowSpan;
+    assert(re.search(input, span) == found);
+    assert(slow.search(input, slowSpan) == found);
+    assert(!found || (span == expected && slowSpan == expected));
+    if (input.size() < 5)
+    {
+      for (char c : std::string("abc"))
+      {
+        inputs.push_back(input + c);
+      }
+    }
+  }
+}
+
+void testSearch()
+{
+  std::cout << "Testing search ..." << std::endl;
+
+  checkSearch("");
+  checkSearch("abc");
+  checkSearch("a*");
+  checkSearch("b+");
+  checkSearch("(abcb)|c");
+  checkSearch("(a|b)*c(a|b)");
+  checkSearch("(ab)+|(ba)+");
+  checkSearch("[ab]c?[^a]");
+
+  Regex re("[0-9]+ms");
+  Span span;
+  assert(re.search("GET /index 200 in 1234ms (cached 12ms)", span));
+  assert(span.begin == 18 && span.end == 24);
+  assert(!re.search("GET /index 200 in 1234s", span));
+
+  // the reversed automaton accepts the mirror language
+  NFA<char> nfa;
+  NFABuilder<char> builder("ab*c", nfa);
+  NFASimulator<char> simulator;
+  NFA<char> reversed = nfa.reversed();
+  assert(simulator.simulate(reversed, "cbba") && simulator.simulate(reversed, "ca"));
+  assert(!simulator.simulate(reversed, "abbc"));
+  assert(simulator.simulate(nfa.unanchored(), "cbabbc"));
+}
+
+// compares findAll() with searches restarted after each match
+static void checkFindAll(char const* expr, std::string const& input)
+{
+  CompileOptions nfaOnly;
+  nfaOnly.engine = CompileOptions::LAZY_DFA;
+  nfaOnly.maxDFAStates = 0;
+  Regex re(expr);
+  Regex slow(expr, nfaOnly);
+
+  std::vector<Span> expected;
+  for (size_t from = 0; from <= input.size(); )
+  {
+    Span span;
+    if (!re.search(input.substr(from), span))
+    {
+      break;
+    }
+    span.begin += from;
+    span.end += from;
+    expected.push_back(span);
+    from = span.length() == 0 ? span.end + 1 : span.end;
+  }
+
+  auto matches = re.findAll(input);
+  assert(std::vector<Span>(matches.begin(), matches.end()) == expected);
+  std::vector<Span> slowSpans;
+  for (Span const& span : slow.findAll(input))
+  {
+    slowSpans.push_back(span);
+  }
+  assert(slowSpans == expected);
+}
+
+void testFindAll()
+{
+  std::cout << "Testing findAll ..." << std::endl;
+
+  checkFindAll("abc", "");
+  checkFindAll("abc", "xabcabcyabc");
+  checkFindAll("a*", "baacaaa");
+  checkFindAll("", "abc");
+  checkFindAll("(ab)+|(ba)+", "abababbabaab");
+  checkFindAll("(abcb)|c", "abcbcbabcb");
+  checkFindAll("[0-9]+ms", "GET /index 200 in 1234ms (cached 12ms)");
+  checkFindAll("a.*", "xxabab");
+  checkFindAll("(abcd)|(bc)|c", "xabcdbcabcc");
+  checkFindAll("(he)|(she)|(hers)|(his)", "ushershishe");
+
+  Regex re("[0-9]+");
+  std::string log = "10 users, 3 errors in 250ms";
+  std::vector<std::string> numbers;
+  for (Span const& span : re.findAll(log))
+  {
+    numbers.push_back(log.substr(span.begin, span.length()));
+  }
+  assert((numbers == std::vector<std::string> { "10", "3", "250" }));
+
+  // the prefilter rejects the whole input at once
+  Regex required("x*needle");
+  auto none = required.findAll("haystack");
+  assert(none.begin() == none.end());
+}
+
+void testReplace()
+{
+  std::cout << "Testing replace ..." << std::endl;
+
+  Regex digits("[0-9]+");
+  assert(digits.replace("card 1234 5678, cvv 123", "#") == "card # #, cvv #");
+  assert(digits.replace("no digit", "#") == "no digit");
+  assert(digits.replace("", "#") == "");
+  assert(digits.replace(std::string("42"), "") == "");
+
+  // empty matches are replaced too, between the symbols
+  assert(Regex("x*").replace("abxc", "-") == "-a-b--c-");
+
+  // with the literal engines
+  assert(Regex("ab").replace("xabyab", "-") == "x-y-");
+  assert(Regex("(cat)|(dog)").replace("hotdog, catalog", "*") == "hot*, *alog");
+
+  // to any output iterator
+  std::ostringstream stream;
+  Regex("(ab)+").replace("xababyab", "<>", std::ostreambuf_iterator<char>(stream));
+  assert(stream.str() == "x<>y<>");
+
+  std::vector<char> buffer(16, '.');
+  auto end = Regex("b").replace("abcb", "BB", buffer.begin());
+  assert(std::string(buffer.begin(), end) == "aBBcBB");
+
+  WRegex wide(L"[0-9]+");
+  assert(wide.replace(L"a1b22", L"_") == L"a_b_");
+}
+
+static Span span(size_t begin, size_t end)
+{
+  Span result;
+  result.begin = begin;
+  result.end = end;
+  return result;
+}
+
+void testCaptures()
+{
+  std::cout << "Testing capture groups ..." << std::endl;
+
+  std::vector<Span> groups;
+  Regex phone("([0-9]+)-([0-9]+)");
+  assert(phone.groupCount() == 2);
+  assert(phone.capture("tel 555-1234 x", groups));
+  assert((groups == std::vector<Span> { span(4, 12), span(4, 7), span(8, 12) }));
+  assert(!phone.capture("tel 5551234", groups));
+
+  // a group which took no part in the match
+  Regex optional("a(b)?c");
+  assert(optional.capture("ac", groups));
+  assert(groups.size() == 2 && groups[0] == span(0, 2) && !groups[1].isSet());
+  assert(Regex("x((a)|(b))").capture("xb", groups));
+  assert(groups[1] == span(1, 2) && !groups[2].isSet() && groups[3] == span(1, 2));
+
+  // repetitions keep their last iteration, and are greedy
+  assert(Regex("((a)|(b))*").capture("ab", groups));
+  assert(groups[1] == span(1, 2) && groups[2] == span(0, 1) && groups[3] == span(1, 2));
+  assert(Regex("(a(b)?)+").capture("abab", groups));
+  assert(groups[1] == span(2, 4) && groups[2] == span(3, 4));
+  assert(Regex("(a*)(a*)").capture("aaa", groups));
+  assert(groups[1] == span(0, 3) && groups[2] == span(3, 3));
+
+  // the groups lie inside the leftmost-longest match
+  assert(Regex("(a|(ab))(c|(bcd))").capture("xabcd", groups));
+  assert(groups[0] == span(1, 5) && groups[1] == span(1, 2) && groups[3] == span(2, 5));
+
+  // no group: the whole match only
+  assert(Regex("b+").capture("abbc", groups));
+  assert((groups == std::vector<Span> { span(1, 3) }));
+
+  // linear, whatever the pattern
+  std::string hostile(20000, 'a');
+  assert(Regex("((a|(aa))*)c").capture(hostile + "c", groups));
+  assert(groups[1] == span(0, 20000));
+  assert(!Regex("((a*)*)b").capture(hostile, groups));
+
+  // on the bytes of UTF-8
+  CompileOptions utf8;
+  utf8.utf8 = true;
+  assert(Regex("([\xC3\xA9]+)x", utf8).capture("a\xC3\xA9\xC3\xA9x", groups));
+  assert(groups[1] == span(1, 5));
+
+  WRegex wide(L"(a+)(b+)");
+  assert(wide.capture(L"xaabbb", groups));
+  assert(groups[1] == span(1, 3) && groups[2] == span(3, 6));
+
+  // the postfix pattern marks the groups
+  std::vector<TokenC> tokens;
+  std::vector<TokenC> npi;
+  Lexer<char> lexer("(a)(b)*", tokens);
+  NPIConvertor<char> convertor(tokens, npi, true);
+  assert(npi.size() == 6 && npi[1].getLabel() == TokenC::GROUP
+    && npi[1].getGroup() == 1 && npi[3].getGroup() == 2);
+}
+
+// compares the one-pass DFA with the PikeVM on every short input
+static void checkOnePass(char const* expr, bool onePass)
+{
+  std::vector<TokenC> tokens;
+  std::vector<TokenC> npi;
+  Lexer<char> lexer(expr, tokens);
+  NPIConvertor<char> convertor(tokens, npi, true);
+  PikeVM<char> vm(npi);
+  OnePassDFA<char> dfa(vm);
+  assert(dfa.isOnePass() == onePass);
+  if (!onePass)
+  {
+    return;
+  }
+
+  std::list<std::string> inputs { "" };
+  for (auto const& input : inputs)
+  {
+    for (size_t begin = 0; begin <= input.size(); begin++)
+    {
+      std::vector<Span> expected;
+      std::vector<Span> groups;
+      Span whole = span(begin, input.size());
+      bool matched = vm.match(input.c_str(), whole, expected);
+      assert(dfa.match(input.c_str(), whole, groups) == matched);
+      assert(!matched || groups == expected);
+    }
+    if (input.size() < 6)
+    {
+      for (char c : std::string("ab-"))
+      {
+        inputs.push_back(input + c);
+      }
+    }
+  }
+}
+
+void testOnePass()
+{
+  std::cout << "Testing OnePassDFA ..." << std::endl;
+
+  checkOnePass("(a+)-(b+)", true);
+  checkOnePass("((a)|(b))*", true);
+  checkOnePass("(a(b)?)+-?", true);
+  checkOnePass("a(-|(b+))a", true);
+  checkOnePass("(a*)(a*)", false);
+  checkOnePass("((a|b)*)-?(a)", false);
+  checkOnePass("(a|(ab))(b)?", false);
+
+  Regex fields("([a-z]+)=([0-9]+)");
+  assert(fields.explain().find("one-pass") != std::string::npos);
+  std::vector<Span> groups;
+  assert(fields.capture("x user=42;", groups));
+  assert(groups[1] == span(2, 6) && groups[2] == span(7, 9));
+
+  // too long to backtrack: the one-pass DFA takes it
+  std::string name(5000, 'u');
+  assert(fields.capture(("x " + name + "=42;").c_str(), groups));
+  assert(groups[1] == span(2, 5002) && groups[2] == span(5003, 5005));
+
+  CompileOptions noDFA;
+  noDFA.maxDFAStates = 0;
+  Regex ambiguous("(a*)(a*)", noDFA);
+  assert(ambiguous.explain().find("Pike VM") != std::string::npos);
+  assert(ambiguous.capture("aa", groups) && groups[2] == span(2, 2));
+}
+
+// compares the tagged DFA and the backtracker with the PikeVM on every
+// short input
+static void checkTagged(char const* expr)
+{
+  std::vector<TokenC> tokens;
+  std::vector<TokenC> npi;
+  Lexer<char> lexer(expr, tokens);
+  NPIConvertor<char> convertor(tokens, npi, true);
+  PikeVM<char> vm(npi);
+  TaggedDFA<char> dfa(vm, 0);
+  BoundedBacktracker<char> backtracker;
+  assert(dfa.isBuilt());
+
+  std::list<std::string> inputs { "" };
+  for (auto const& input : inputs)
+  {
+    for (size_t begin = 0; begin <= input.size(); begin++)
+    {
+      for (size_t end = begin; end <= input.size(); end++)
+      {
+        std::vector<Span> expected;
+        std::vector<Span> groups;
+        bool matched = vm.match(input.c_str(), span(begin, end), expected);
+        assert(dfa.match(input.c_str(), span(begin, end), groups) == matched);
+        assert(!matched || groups == expected);
+        assert(backtracker.match(vm, input.c_str(), span(begin, end), groups) == matched);
+        assert(!matched || groups == expected);
+      }
+    }
+    if (input.size() < 6)
+    {
+      for (char c : std::string("ab-"))
+      {
+        inputs.push_back(input + c);
+      }
+    }
+  }
+}
+
+void testTaggedDFA()
+{
+  std::cout << "Testing TaggedDFA ..." << std::endl;
+
+  checkTagged("(a*)(a*)");
+  checkTagged("((a|b)*)-?(a)");
+  checkTagged("(a|(ab))(b)?");
+  checkTagged("((a)|(ab)|(b))*");
+  checkTagged("(a*)*(b)");
+  checkTagged("((a+)|(b+))*(a)?-(a|b)*");
+  checkTagged("(((a)(b)?)|((ab)-))+");
+  checkTagged("(a|b)*(a(b))?(b)?");
+  checkTagged("a+");
+
+  std::vector<Span> groups;
+  Regex fields("([A-Z]+) ([a-z ]+) id([0-9]+)");
+  assert(fields.explain().find("tagged DFA") != std::string::npos);
+  assert(fields.capture("2014 WARN disk full id42", groups));
+  assert(groups[1] == span(5, 9) && groups[2] == span(10, 19)
+    && groups[3] == span(22, 24));
+  std::string message(5000, 'x');
+  assert(fields.capture(("2014 WARN " + message + " id42").c_str(), groups));
+  assert(groups[1] == span(5, 9) && groups[2] == span(10, 5010)
+    && groups[3] == span(5013, 5015));
+
+  // beyond maxDFAStates, the PikeVM takes over
+  CompileOptions small;
+  small.maxDFAStates = 2;
+  Regex pike("([A-Z]+) ([a-z ]+) id([0-9]+)", small);
+  assert(pike.explain().find("Pike VM") != std::string::npos);
+  assert(pike.capture("2014 WARN disk full id42", groups));
+  assert(groups[2] == span(10, 19));
+}
+
+void testBacktracker()
+{
+  std::cout << "Testing BoundedBacktracker ..." << std::endl;
+
+  std::vector<TokenC> tokens;
+  std::vector<TokenC> npi;
+  Lexer<char> lexer("((a*)*)(b)", tokens);
+  NPIConvertor<char> convertor(tokens, npi, true);
+  PikeVM<char> vm(npi);
+  assert(BoundedBacktracker<char>::fits(vm, span(0, 64)));
+  assert(!BoundedBacktracker<char>::fits(vm, span(0, 10000)));
+
+  // each (instruction, position) is explored once, even when it fails
+  std::string input(60, 'a');
+  BoundedBacktracker<char> backtracker;
+  std::vector<Span> groups;
+  assert(!backtracker.match(vm, input.c_str(), span(0, 60), groups));
+  input += 'b';
+  assert(backtracker.match(vm, input.c_str(), span(0, 61), groups));
+  assert(groups[1] == span(0, 60) && groups[3] == span(60, 61));
+
+  // without the tagged DFA, the short matches backtrack and the long ones
+  // go to the PikeVM
+  CompileOptions noDFA;
+  noDFA.maxDFAStates = 0;
+  Regex re("(a|(ab))*(b*)", noDFA);
+  std::string shortInput = "abab";
+  std::string longInput;
+  for (int i = 0; i < 5000; i++)
+  {
+    longInput += "ab";
+  }
+  assert(re.explain().find("backtracking") != std::string::npos);
+  assert(re.capture(shortInput, groups) && groups[1] == span(2, 3)
+    && groups[2] == span(0, 2) && groups[3] == span(3, 4));
+  assert(re.capture(longInput, groups) && groups[1] == span(9998, 9999)
+    && groups[2] == span(9996, 9998) && groups[3] == span(9999, 10000));
+}
+
+void checkBatch(std::string const& pattern, CompileOptions const& options)
+{
+  Regex re(pattern, options);
+  // every word of at most 5 symbols over {a, b, c}, then longer ones
+  std::vector<std::string> inputs(1, "");
+  for (size_t i = 0; inputs.back().size() <= 5; i++)
+  {
+    for (char symbol : std::string("abc"))
+    {
+      inputs.push_back(inputs[i] + symbol);
+    }
+  }
+  for (int i = 0; i < 13; i++)
+  {
+    inputs.push_back(std::string(i * 7, 'a') + "bc" + std::string(i, 'c'));
+  }
+
+  std::vector<bool> results;
+  re.matchBatch(inputs, results);
+  std::vector<char const*> pointers;
+  for (auto const& input : inputs)
+  {
+    pointers.push_back(input.c_str());
+  }
+  std::unique_ptr<bool[]> raw(new bool[inputs.size()]);
+  re.matchBatch(pointers.data(), pointers.size(), raw.get());
+  assert(results.size() == inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    assert(results[i] == re.match(inputs[i]));
+    assert(raw[i] == results[i]);
+  }
+}
+
+void testBatch()
+{
+  std::cout << "Testing matchBatch ..." << std::endl;
+
+  CompileOptions noDFA;
+  noDFA.maxDFAStates = 0;
+  CompileOptions fewStates;
+  fewStates.maxDFAStates = 4;
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  for (auto const& options : {CompileOptions(), noDFA, fewStates, lazy})
+  {
+    checkBatch("(a|b)*c", options);
+    checkBatch("a*bc*", options);
+    checkBatch("(a|b)*a(a|b)(a|b)", options);
+    checkBatch("abc", options);
+    checkBatch("", options);
+  }
+
+  // strongly uneven lengths within the groups of lanes
+  Regex keys("[a-z]+(_[a-z]+)*_[0-9]+");
+  std::vector<std::string> uneven;
+  for (size_t i = 0; i < 37; i++)
+  {
+    size_t length = i % 8 == 0 ? 1 + i : (i % 3 == 0 ? 200 + i : 10 + i % 30);
+    std::string key(length, "abcxyz"[i % 6]);
+    key += i % 5 == 0 ? "_x" : "_" + std::to_string(i);
+    uneven.push_back(i % 7 == 0 ? "" : key);
+  }
+  std::vector<bool> unevenResults;
+  keys.matchBatch(uneven, unevenResults);
+  for (size_t i = 0; i < uneven.size(); i++)
+  {
+    assert(unevenResults[i] == keys.match(uneven[i]));
+  }
+  // one group of lanes, with and without a spare column in the DFA rows
+  for (char const* pattern : {"[a-z]+(_[a-z]+)*_[0-9]+", "(ab)*"})
+  {
+    NFA<char> nfa;
+    NFABuilder<char> nfaBuilder(pattern, nfa);
+    DFA<char> dfa;
+    DFABuilder<char> dfaBuilder(nfa, dfa);
+    BatchDFA<char> batch(dfa);
+    std::vector<std::string> group = {"", std::string(300, 'a') + "_7",
+      "c", std::string(150, 'b') + "c", "ab_1", std::string(299, 'a') + "_",
+      std::string(64, 'a') + "c", "abababababab"};
+    char const* pointers[BatchDFA<char>::LANES];
+    size_t lengths[BatchDFA<char>::LANES];
+    bool groupResults[BatchDFA<char>::LANES];
+    for (size_t lane = 0; lane < group.size(); lane++)
+    {
+      pointers[lane] = group[lane].c_str();
+      lengths[lane] = group[lane].size();
+    }
+    batch.accepts(pointers, lengths, group.size(), groupResults);
+    for (size_t lane = 0; lane < group.size(); lane++)
+    {
+      assert(groupResults[lane] == dfa.accepts(pointers[lane]));
+    }
+  }
+
+  // counts that are not a multiple of the lanes, and wide symbols
+  WRegex wre(L"(a|b)*c");
+  std::vector<std::wstring> winputs = {L"", L"c", L"abc", L"abd", L"bbbbbbbbbbbbc"};
+  std::vector<bool> results;
+  wre.matchBatch(winputs, results);
+  assert(results == std::vector<bool>({false, true, true, false, true}));
+  wre.matchBatch(std::vector<std::wstring>(), results);
+  assert(results.empty());
+}
+
+void testDFALayout()
+{
+  std::cout << "Testing the DFA layout ..." << std::endl;
+
+  NFA<char> nfa;
+  NFABuilder<char> builder("(a|b)*a(a|b)(a|b)(c|d)*", nfa);
+  DFA<char> dfa;
+  DFABuilder<char> dfaBuilder(nfa, dfa);
+  // a row is a power of two or whole cache lines
+  size_t lineColumns = DFA<char>::CACHE_LINE / sizeof(DStateId);
+  assert(dfa.stride() >= dfa.columns());
+  assert(dfa.stride() % lineColumns == 0 || lineColumns % dfa.stride() == 0);
+  assert(reinterpret_cast<uintptr_t>(dfa.table()) % DFA<char>::CACHE_LINE == 0);
+
+  // premultiplied ids, breadth-first from the initial state
+  assert(dfa.getInitial() == 0);
+  DStateId state = dfa.next(dfa.getInitial(), 'a');
+  assert(state % dfa.stride() == 0 && state / dfa.stride() < dfa.size());
+  assert(dfa.table()[dfa.getInitial() + dfa.columnOf('a')] == state);
+  assert(dfa.isDead(dfa.next(dfa.getInitial(), 'x')));
+  assert(dfa.isDecided(dfa.next(dfa.getInitial(), 'x')));
+
+  // reordering keeps the language
+  std::vector<std::string> inputs = {"", "a", "ab", "aab", "babab", "aaac",
+    "abbcd", "abbcda", "bbbbbbbaaa", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"};
+  std::vector<bool> expected;
+  for (auto const& input : inputs)
+  {
+    expected.push_back(dfa.accepts(input.c_str()));
+  }
+  std::vector<size_t> visits(dfa.size(), 0);
+  std::string hot(100, 'b');
+  dfa.countVisits(hot.c_str(), visits);
+  DStateId before = dfa.next(dfa.getInitial(), 'b');
+  dfa.reorder(visits);
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    assert(dfa.accepts(inputs[i].c_str()) == expected[i]);
+  }
+  // the state looping on 'b' is now the first one
+  assert(before != 0 && dfa.next(dfa.getInitial(), 'b') == 0);
+
+  CompileOptions eager;
+  eager.engine = CompileOptions::EAGER_DFA;
+  Regex re("(a|b)*a(a|b)(a|b)(c|d)*", eager);
+  re.train(inputs);
+  re.train(std::vector<std::string>());
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    assert(re.match(inputs[i]) == expected[i]);
+  }
+}
+
+void testCopies()
+{
+  std::cout << "Testing copies ..." << std::endl;
+
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  Regex original("(a|b)*abb(c)?", lazy);
+  std::vector<Regex> copies(4, original);
+  copies.push_back(copies.back());
+  Regex other("x");
+  other = original;
+  copies.push_back(other);
+  for (auto const& copy : copies)
+  {
+    assert(copy.getEngine() == CompileOptions::LAZY_DFA);
+    assert(copy.match("babb") && copy.match("aabbc") && !copy.match("abba"));
+    std::vector<Span> groups;
+    assert(copy.capture("xxabbc", groups) && groups[2] == span(5, 6));
+  }
+  assert(original.explain() == copies[0].explain());
+
+  // each copy has its own caches and counters
+  copies[0].setCacheBudget(1024);
+  assert(copies[0].getCacheBudget() == 1024);
+  assert(original.getCacheBudget() == lazy.cacheBudget);
+  InstrumentedRegex counted("ab*");
+  assert(counted.match("abbb"));
+  InstrumentedRegex countedCopy(counted);
+  assert(countedCopy.getStats().calls == 0 && counted.getStats().calls == 1);
+
+  // training gives the copy a program of its own
+  CompileOptions eager;
+  eager.engine = CompileOptions::EAGER_DFA;
+  Regex trained("(a|b)*a(a|b)", eager);
+  Regex untrained(trained);
+  trained.train(std::vector<std::string>({"bbbbbbbbab"}));
+  for (std::string input : {"ab", "ba", "aaa", "bbb", "bbbbab"})
+  {
+    assert(trained.match(input) == untrained.match(input));
+  }
+
+  // the copies run concurrently on the shared program
+  std::vector<std::thread> threads;
+  std::atomic<size_t> matches(0);
+  for (size_t i = 0; i < 4; i++)
+  {
+    threads.emplace_back([&copies, &matches, i] () {
+      for (int j = 0; j < 200; j++)
+      {
+        Span span;
+        matches += copies[i].match(std::string(j, 'a') + "abb") ? 1 : 0;
+        matches += copies[i].search(std::string(j, 'b') + "abbx", span) ? 1 : 0;
+      }
+    });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  assert(matches == 4 * 400);
+}
+
+void testEarlyTermination()
+{
+  std::cout << "Testing early termination ..." << std::endl;
+
+  NFA<char> nfa;
+  NFABuilder<char> builder("ab.*", nfa);
+  std::vector<bool> universal = nfa.universalStates();
+  assert(std::count(universal.begin(), universal.end(), true) > 0);
+  assert(!universal[nfa.getInitial()]);
+  NFASimulator<char> simulator(nullptr, &universal);
+  assert(simulator.simulate(nfa, "abxyz") && !simulator.simulate(nfa, "axyz"));
+
+  NFA<char> bounded;
+  NFABuilder<char> boundedBuilder("a[^x]*", bounded);
+  universal = bounded.universalStates();
+  assert(std::count(universal.begin(), universal.end(), true) == 0);
+
+  PositionAutomaton<char> positions;
+  GlushkovBuilder<char> glushkov(builder.postfix(), positions);
+  BitParallel<char> bitParallel(positions);
+  assert(bitParallel.getUniversalMask() == (positions.bit(2) | positions.bit(3)));
+  assert(bitParallel.match("abxyz") && !bitParallel.match("ba"));
+
+  // the lazy DFA reads the input up to the verdict only
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  std::string tail(1000, 'z');
+  InstrumentedRegex prefix("ab.*", lazy);
+  assert(prefix.match("ab" + tail));
+  RegexStats stats = prefix.getStats();
+  assert(stats.cacheHits + stats.cacheMisses == 2);
+  InstrumentedRegex dead("ab(c|d)*", lazy);
+  assert(!dead.match("abx" + tail));
+  stats = dead.getStats();
+  assert(stats.cacheHits + stats.cacheMisses == 3);
+
+  // and so does the eager DFA
+  CompileOptions eager;
+  eager.engine = CompileOptions::EAGER_DFA;
+  NFA<char> eagerNFA;
+  NFABuilder<char> eagerBuilder("ab.*", eagerNFA);
+  DFA<char> dfa;
+  DFABuilder<char> dfaBuilder(eagerNFA, dfa);
+  DStateId state = dfa.next(dfa.getInitial(), 'a');
+  assert(!dfa.isDecided(state));
+  state = dfa.next(state, 'b');
+  assert(dfa.isDecided(state) && dfa.isAcceptor(state));
+  assert(dfa.isDead(dfa.next(dfa.getInitial(), 'b')));
+  Regex eagerRegex("ab.*", eager);
+  assert(eagerRegex.match("ab" + tail) && !eagerRegex.match("b" + tail));
+
+  Span span;
+  assert(eagerRegex.search("xxab" + tail, span));
+  assert(span.begin == 2 && span.end == tail.size() + 4);
+}
+
+static std::vector<TokenC> optimized(char const* expr)
+{
+  std::vector<TokenC> tokens;
+  std::vector<TokenC> npi;
+  std::vector<TokenC> result;
+  Lexer<char> lexer(expr, tokens);
+  NPIConvertor<char> convertor(tokens, npi);
+  Optimizer<char> optimizer(npi, result);
+  return result;
+}
+
+// the optimized regex must accept the same strings of {a, b, c, d} up to 5
+// symbols as the NFA built verbatim, with no more states.
+static void checkOptimizer(char const* expr)
+{
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  Regex re(expr, lazy);
+
+  NFA<char> nfa;
+  NFABuilder<char> builder(expr, nfa);
+  NFASimulator<char> simulator;
+
+  NFA<char> optimizedNFA;
+  NFABuilder<char> optimizedBuilder(optimized(expr), optimizedNFA);
+  assert(optimizedNFA.size() <= nfa.size());
+
+  std::list<std::string> inputs { "" };
+  for (auto const& input : inputs)
+  {
+    assert(re.match(input.c_str()) == simulator.simulate(nfa, input.c_str()));
+    if (input.size() < 5)
+    {
+      for (char c : std::string("abcd"))
+      {
+        inputs.push_back(input + c);
+      }
+    }
+  }
+}
+
+void testOptimizer()
+{
+  std::cout << "Testing Optimizer ..." << std::endl;
+
+  std::vector<TokenC> star { TokenC(TokenC::LAMBDA, 'a'), TokenC(TokenC::STAR) };
+  assert(compareTokenCList(optimized("a**"), star));
+  assert(compareTokenCList(optimized("(a?)*"), star));
+  assert(compareTokenCList(optimized("(a+)?"), star));
+  assert(compareTokenCList(optimized("((a*)+)?"), star));
+
+  std::vector<TokenC> merged = optimized("a|b|[c-e]");
+  assert(merged.size() == 1 && merged.front().getLabel() == TokenC::CLASS);
+  assert(merged.front().getRanges() == SymbolRanges<char>('a', 'e'));
+
+  // ab[cd]
+  std::vector<TokenC> prefix = optimized("(abc)|(abd)");
+  std::vector<TokenC> factored {
+    TokenC(TokenC::LAMBDA), TokenC(TokenC::LAMBDA), TokenC(TokenC::CONCAT),
+    TokenC(TokenC::CLASS), TokenC(TokenC::CONCAT)
+  };
+  assert(compareTokenCList(prefix, factored));
+
+  // a?b
+  std::vector<TokenC> suffix = optimized("(ab)|b");
+  std::vector<TokenC> optional {
+    TokenC(TokenC::LAMBDA), TokenC(TokenC::OPTION), TokenC(TokenC::LAMBDA),
+    TokenC(TokenC::CONCAT)
+  };
+  assert(compareTokenCList(suffix, optional));
+  assert(optimized("(ab)|(ab)").size() == 3);
+
+  checkOptimizer("a**");
+  checkOptimizer("(a?)*b+");
+  checkOptimizer("((a|b)+)+c");
+  checkOptimizer("(abc)|(abd)|(abcd)|(bcd)");
+  checkOptimizer("(a|b|c)d|(a|d)");
+  checkOptimizer("((ab)|(ac)|a)*d?");
+  checkOptimizer("(a(b|c)d)|(a(b|c)c)|(dd)");
+  checkOptimizer("((ab)|b|(cb))+");
+  checkOptimizer("(a?|b?)*|c");
+}
+
+void testStats()
+{
+  std::cout << "Testing RegexStats ..." << std::endl;
+
+  CompileOptions lazy;
+  lazy.engine = CompileOptions::LAZY_DFA;
+  InstrumentedRegex re("(a|b)*cab+", lazy);
+  assert(re.match("abcabb"));
+  assert(re.match("cabbbb"));
+  assert(!re.match("abcb"));
+  assert(!re.match("cabc"));
+
+  RegexStats stats = re.getStats();
+  assert(stats.calls == 4);
+  assert(stats.bytesScanned == 20);
+  assert(stats.matches == 2);
+  assert(stats.prefilterChecks == 4);
+  assert(stats.prefilterCandidates == 3);
+  assert(stats.prefilterConfirms == 2);
+  assert(stats.cacheMisses > 0 && stats.cacheHits > 0);
+  assert(stats.nfaStatesVisited > 0 && stats.epsilonClosureWork > 0);
+  assert(stats.toJSON().find("\"matches\": 2") != std::string::npos);
+  assert(stats.toPrometheus("x").find("regex_matches_total{pattern=\"x\"} 2")
+    != std::string::npos);
+
+  // without instrumentation, nothing is counted
+  Regex plain("(a|b)*cab+", lazy);
+  assert(plain.match("abcabb"));
+  assert(plain.getStats().calls == 0);
+}
+
+void testCompileAll()
+{
+  std::cout << "Testing compileAll ..." << std::endl;
+
+  std::vector<std::string> patterns;
+  for (int i = 0; i < 300; i++)
+  {
+    patterns.push_back("id" + std::to_string(i) + "(a|b)*");
+  }
+  patterns[7] = "(ab";
+  patterns[250] = "*a";
+
+  for (unsigned threads : {1u, 4u, 0u})
+  {
+    auto compiled = compileAll<Regex>(patterns, CompileOptions(), threads);
+    assert(compiled.size() == patterns.size());
+    for (size_t i = 0; i < compiled.size(); i++)
+    {
+      if (i == 7 || i == 250)
+      {
+        assert(!compiled[i].regex && !compiled[i].error.empty());
+        continue;
+      }
+      assert(compiled[i].regex && compiled[i].error.empty());
+      assert(compiled[i].regex->match("id" + std::to_string(i) + "abba"));
+      assert(!compiled[i].regex->match("id" + std::to_string(i) + "c"));
+    }
+  }
+
+  // the limits apply to each pattern
+  CompileOptions small;
+  small.maxNFAStates = 20;
+  auto limited = compileAll<Regex>(std::vector<std::string>{"ab", alternations(20)}, small);
+  assert(limited[0].regex && !limited[1].regex);
+  assert(limited[1].error == "too many NFA states");
+
+  assert(compileAll<WRegex>(std::vector<std::wstring>()).empty());
+}
+
+void testHotSwap()
+{
+  std::cout << "Testing hot swaps ..." << std::endl;
+
+  HotSwap<Regex> rules(Regex("a+"));
+  assert(rules.version() == 0 && rules.read()->match("aaa"));
+  {
+    auto pinned = rules.read();
+    rules.publish(std::unique_ptr<Regex>(new Regex("b+")));
+    // the pinned reader finishes on its version, the next ones see the new one
+    assert(pinned->match("aaa") && !pinned->match("bbb"));
+    assert(rules.read()->match("bbb") && !rules.read()->match("aaa"));
+  }
+  assert(rules.version() == 1);
+
+  auto reloaded = rules.reload(std::string("c+"));
+  reloaded.get();
+  assert(rules.version() == 2 && rules.read()->match("ccc"));
+  bool thrown = false;
+  try
+  {
+    rules.reload(std::string("(c")).get();
+  }
+  catch (std::invalid_argument const&)
+  {
+    thrown = true;
+  }
+  assert(thrown && rules.version() == 2 && rules.read()->match("ccc"));
+
+  // a dropped future does not wait for the new version, which still goes
+  // live; the destructor waits for the reloads still running
+  struct Gated
+  {
+    explicit Gated(std::atomic<bool> const* open)
+    {
+      while (!*open)
+      {
+        std::this_thread::yield();
+      }
+    }
+  };
+  std::atomic<bool> open(true);
+  {
+    HotSwap<Gated> gated(std::unique_ptr<Gated>(new Gated(&open)));
+    open = false;
+    gated.reload(&open);
+    assert(gated.version() == 0);
+    open = true;
+    while (gated.version() == 0)
+    {
+      std::this_thread::yield();
+    }
+    gated.reload(&open);
+  }
+
+  // the replaced versions are deleted once their readers are gone
+  struct Counted
+  {
+    std::atomic<int>& alive;
+    explicit Counted(std::atomic<int>& alive) : alive(alive) { alive++; }
+    ~Counted() { alive--; }
+  };
+  std::atomic<int> alive(0);
+  {
+    HotSwap<Counted> counted(std::unique_ptr<Counted>(new Counted(alive)));
+    counted.publish(std::unique_ptr<Counted>(new Counted(alive)));
+    assert(alive == 1);
+    {
+      auto pinned = counted.read();
+      counted.publish(std::unique_ptr<Counted>(new Counted(alive)));
+      assert(alive == 2);
+    }
+    counted.publish(std::unique_ptr<Counted>(new Counted(alive)));
+    assert(alive == 1);
+  }
+  assert(alive == 0);
+
+  // readers match concurrently with the publications, each on one version
+  rules.publish(std::unique_ptr<Regex>(new Regex("a+")));
+  std::atomic<bool> done(false);
+  std::atomic<size_t> reads(0);
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < 4; i++)
+  {
+    readers.emplace_back([&rules, &done, &reads] () {
+      while (!done)
+      {
+        auto version = rules.read();
+        bool a = version->match("aaa");
+        bool b = version->match("bbb");
+        assert(a != b);
+        (void)a;
+        (void)b;
+        reads++;
+      }
+    });
+  }
+  for (int i = 0; i < 100; i++)
+  {
+    rules.reload(std::string(i % 2 == 0 ? "a+" : "b+")).get();
+  }
+  done = true;
+  for (auto& reader : readers)
+  {
+    reader.join();
+  }
+  assert(rules.version() == 103 && rules.read()->match("bbb"));
+}
+
+// the tokens by maximal munch, from a loop over one regex per pattern
+static std::vector<TokenMatch> munchTokens(std::vector<std::string> const& patterns,
+  std::string const& input, size_t& covered)
+{
+  std::vector<Regex> regexes(patterns.begin(), patterns.end());
+  std::vector<TokenMatch> tokens;
+  covered = 0;
+  while (covered < input.size())
+  {
+    TokenMatch token;
+    for (size_t end = input.size(); end > covered && token.span.end == 0; end--)
+    {
+      for (size_t id = 0; id < regexes.size(); id++)
+      {
+        if (regexes[id].match(input.substr(covered, end - covered)))
+        {
+          token.id = id;
+          token.span = span(covered, end);
+          break;
+        }
+      }
+    }
+    if (token.span.end == 0)
+    {
+      break;
+    }
+    tokens.push_back(token);
+    covered = token.span.end;
+  }
+  return tokens;
+}
+
+void testTokenizer()
+{
+  std::cout << "Testing tokenizers ..." << std::endl;
+
+  enum { IF, ELSE, NAME, NUMBER, SPACE, EQUALS, ASSIGN };
+  std::vector<std::string> patterns { "if", "else", "[a-z][a-z0-9]*", "[0-9]+",
+    " +", "==", "=" };
+  Tokenizer tokenizer(patterns);
+  assert(tokenizer.size() == patterns.size());
+
+  size_t covered = 0;
+  auto tokens = tokenizer.tokenize("if iff == 42 else x2=1", &covered);
+  std::vector<size_t> ids { IF, SPACE, NAME, SPACE, EQUALS, SPACE, NUMBER, SPACE,
+    ELSE, SPACE, NAME, ASSIGN, NUMBER };
+  assert(covered == 22 && tokens.size() == ids.size());
+  for (size_t i = 0; i < ids.size(); i++)
+  {
+    assert(tokens[i].id == ids[i]);
+  }
+  assert(tokens[2].span == span(3, 6) && tokens[12].span == span(21, 22));
+
+  // the scan stops where no token starts
+  tokens = tokenizer.tokenize("if $x", &covered);
+  assert(tokens.size() == 2 && covered == 3);
+  TokenMatch token;
+  assert(!tokenizer.next("if $x", 3, token));
+  assert(tokenizer.next("if $x", 4, token) && token.id == NAME && token.span == span(4, 5));
+  assert(tokenizer.tokenize("", &covered).empty() && covered == 0);
+
+  // the same tokens as a loop over separate regexes
+  std::vector<std::string> inputs { "else elsewhere if1 ===", "a==b=c 0x12 if",
+    "   ", "ifelse if else", "12ab 3 = =" };
+  std::mt19937 random(12);
+  for (int i = 0; i < 50; i++)
+  {
+    std::string input;
+    for (size_t length = random() % 20; length > 0; length--)
+    {
+      input += "iefls x0= "[random() % 10];
+    }
+    inputs.push_back(input);
+  }
+  for (auto const& input : inputs)
+  {
+    size_t expectedCovered;
+    auto expected = munchTokens(patterns, input, expectedCovered);
+    tokens = tokenizer.tokenize(input, &covered);
+    assert(covered == expectedCovered && tokens.size() == expected.size());
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+      assert(tokens[i].id == expected[i].id && tokens[i].span == expected[i].span);
+    }
+  }
+
+  WTokenizer wide({ L"[a-z]+", L"[0-9]+" });
+  assert(wide.tokenize(std::wstring(L"abc123")).size() == 2);
+
+  CompileOptions utf8;
+  utf8.utf8 = true;
+  Tokenizer words({ "\xD0\xBE+", "." }, utf8);
+  tokens = words.tokenize("\xD0\xBE\xD0\xBE\xD1\x88", &covered);
+  assert(tokens.size() == 2 && tokens[0].id == 0 && tokens[1].span == span(4, 6)
+    && covered == 6);
+  try
+  {
+    WTokenizer failed({ L"a" }, utf8);
+    assert(false);
+  }
+  catch (std::invalid_argument const&)
+  {
+  }
+
+  for (auto invalid : { std::vector<std::string>(),
+    std::vector<std::string>({ "a", "b*" }), std::vector<std::string>({ "(a" }) })
+  {
+    bool thrown = false;
+    try
+    {
+      Tokenizer failed(invalid);
+    }
+    catch (std::invalid_argument const&)
+    {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+}
+
+static unsigned levenshtein(std::string const& a, std::string const& b)
+{
+  std::vector<unsigned> row(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); j++)
+  {
+    row[j] = static_cast<unsigned>(j);
+  }
+  for (size_t i = 1; i <= a.size(); i++)
+  {
+    unsigned diagonal = row[0];
+    row[0] = static_cast<unsigned>(i);
+    for (size_t j = 1; j <= b.size(); j++)
+    {
+      unsigned above = row[j];
+      row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1),
+        diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+      diagonal = above;
+    }
+  }
+  return row[b.size()];
+}
+
+void testApproximate()
+{
+  std::cout << "Testing approximate matching ..." << std::endl;
+
+  Regex color("colou?r");
+  assert(color.matchApprox("colour", 0) && color.matchApprox("colr", 1));
+  assert(color.matchApprox("calor", 1) && color.matchApprox("coloeur", 1));
+  assert(!color.matchApprox("clr", 1) && color.distance("clr", 3) == 2);
+  assert(color.distance(std::string("xyz"), 2) == 3);
+  assert(Regex("[0-9]+-[0-9]+").distance("555x1234", 2) == 1);
+  assert(Regex("ab.*").distance("xbcccccccccccc", 1) == 1);
+
+  Span occurrence;
+  unsigned errors = 0;
+  assert(Regex("brown").searchApprox("the quick brwn fox", 1, occurrence, &errors));
+  assert(occurrence == span(10, 14) && errors == 1);
+  assert(!Regex("brown").searchApprox("the quick fox", 1, occurrence));
+  assert(Regex("a*").searchApprox("bbb", 0, occurrence) && occurrence == span(0, 0));
+
+  WRegex wide(L"gr(a|e)y");
+  assert(wide.matchApprox(L"grey", 0) && wide.matchApprox(L"gray!", 1));
+
+  bool thrown = false;
+  try
+  {
+    Regex(std::string(70, 'a')).matchApprox("a", 1);
+  }
+  catch (std::invalid_argument const&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // against the edit distance to every word of the language up to 7 symbols
+  std::vector<std::string> words { "" };
+  for (size_t begin = 0, length = 1; length <= 7; length++)
+  {
+    size_t end = words.size();
+    for (size_t i = begin; i < end; i++)
+    {
+      for (char symbol : std::string("abcx"))
+      {
+        words.push_back(words[i] + symbol);
+      }
+    }
+    begin = end;
+  }
+  std::mt19937 random(50);
+  for (std::string pattern : { "abc", "a(b|c)*a", "(ab)*c?", "a.c", "b+", "[ab]c*" })
+  {
+    Regex re(pattern);
+    std::vector<std::string> language;
+    for (auto const& word : words)
+    {
+      if (re.match(word))
+      {
+        language.push_back(word);
+      }
+    }
+    auto distanceTo = [&language] (std::string const& input, unsigned maxErrors) {
+      unsigned best = maxErrors + 1;
+      for (auto const& word : language)
+      {
+        best = std::min(best, levenshtein(input, word));
+      }
+      return best;
+    };
+    for (int i = 0; i < 40; i++)
+    {
+      std::string input;
+      for (size_t length = random() % 6; length > 0; length--)
+      {
+        input += "abcx"[random() % 4];
+      }
+      for (unsigned k = 0; k <= 2; k++)
+      {
+        assert(re.distance(input, k) == distanceTo(input, k));
+
+        // the first end, the fewest errors there and the leftmost start
+        Span expected;
+        unsigned expectedErrors = k + 1;
+        for (size_t end = 0; end <= input.size() && expectedErrors > k; end++)
+        {
+          for (size_t begin = 0; begin <= end; begin++)
+          {
+            unsigned d = distanceTo(input.substr(begin, end - begin), k);
+            if (d < expectedErrors)
+            {
+              expectedErrors = d;
+              expected = span(begin, end);
+            }
+          }
+        }
+        bool found = re.searchApprox(input, k, occurrence, &errors);
+        assert(found == (expectedErrors <= k));
+        assert(!found || (occurrence == expected && errors == expectedErrors));
+      }
+    }
+  }
+}
+
+int main()
 {
   std::cout << "Let's test every classes one by one :" << std::endl;
   testNFA();
   testLexer();
   testNPIConvertor();
+  testLazyDFA();
+  testCompileOptions();
+  testPlanner();
+  testClasses();
+  testUtf8();
+  testSearch();
+  testFindAll();
+  testReplace();
+  testCaptures();
+  testOnePass();
+  testTaggedDFA();
+  testBacktracker();
+  testBatch();
+  testDFALayout();
+  testCopies();
+  testEarlyTermination();
+  testOptimizer();
+  testStats();
+  testCompileAll();
+  testHotSwap();
+  testTokenizer();
+  testApproximate();
   std::cout << "All the tests passed with success !!!" << std::endl;
   return 0;
 }
\ No newline at end of file